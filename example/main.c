@@ -4,6 +4,9 @@
 ////////////////////////////////////////////////////////////////////////////////
 // $Headers
 ////////////////////////////////////////////////////////////////////////////////
+// std
+#include <stdio.h>
+
 // local
 #include <ehsh/ehsh.h>
 #include <ehsh/extra/ehcmd.h>
@@ -22,37 +25,62 @@
 ////////////////////////////////////////////////////////////////////////////////
 // $Functions
 ////////////////////////////////////////////////////////////////////////////////
+/// Runs a script file instead of an interactive session, then reports how it went.
+static void RunScript(EhShell_t* shell, const char* path)
+{
+  char report[128];
+#if WIN32
+  snprintf(report, sizeof(report), "Scripts are not supported on this platform: %s", path);
+#else
+  EhLinuxScript_t script;
+  if (EhLinuxRunFile(shell, path, &script) != 0)
+  {
+    snprintf(report, sizeof(report), "Cannot open %s", path);
+  }
+  else if (script.FailedLine != 0)
+  {
+    snprintf(report, sizeof(report), "%s:%zu: failed", path, script.FailedLine);
+  }
+  else
+  {
+    snprintf(report, sizeof(report), "%zu lines in %.3f s (%.0f lines/s)", script.Lines, script.Seconds, script.LinesPerSec);
+  }
+#endif
+  EhPutStr(shell, report);
+  EhPutNewline(shell);
+}
+
 /// [Main]
-int main(void)
+int main(int argc, char* argv[])
 {
   EhPlatform_t* platform = NULL;
   EhPlatformInit(&platform);
 
   const EhCommand_t cmds[] = {
     {
-      "#",
-      "Comment",
-      &EhComment,
+      .Name     = "#",
+      .Help     = "Comment",
+      .Callback = &EhComment,
     },
     {
-      "echo",
-      "Prints arguments",
-      &EhEcho,
+      .Name     = "echo",
+      .Help     = "Prints arguments",
+      .Callback = &EhEcho,
     },
     {
-      "exit",
-      "Exits",
-      &EhExit,
+      .Name     = "exit",
+      .Help     = "Exits",
+      .Callback = &EhExit,
     },
     {
-      "help",
-      "Prints commands",
-      &EhHelp,
+      .Name     = "help",
+      .Help     = "Prints commands",
+      .Callback = &EhHelp,
     },
     {
-      "stty",
-      "Configure shell EOL, TTY",
-      &EhStty,
+      .Name     = "stty",
+      .Help     = "Configure shell EOL, TTY",
+      .Callback = &EhStty,
     },
   };
   EhShell_t shell;
@@ -61,12 +89,20 @@ int main(void)
     &(EhConfig_t){
       .Commands     = cmds,
       .CommandCount = sizeof(cmds) / sizeof(*cmds),
+      .Platform     = platform,
       .Eol          = MAIN_EOL,
       .Tty          = true,
       .Cr           = true,
       .Lf           = true,
     });
-  EhExec(&shell);
+  if (argc > 1)
+  {
+    RunScript(&shell, argv[1]);
+  }
+  else
+  {
+    EhExec(&shell);
+  }
   EhDeInit(&shell);
 
   EhPlatformDeInit(&platform);
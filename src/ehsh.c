@@ -6,7 +6,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 // std
 #include <stdbool.h>  // bool
-#include <string.h>   // memset
+#include <string.h>   // memcpy, memset
 
 // local
 #include <ehsh/ehsh.h>
@@ -15,9 +15,75 @@
 ////////////////////////////////////////////////////////////////////////////////
 // $Macros
 ////////////////////////////////////////////////////////////////////////////////
-#if __STDC_VERSION__ > 201112L  // for static_assert
-static_assert(EHSH_MAX_ARGS <= 15, "ehsh currently only supports up to a maximum of 15 arguments");
-#endif /* __STDC_VERSION__ > 201112L */
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+#define EHSH_STATIC_ASSERT(expr, msg) _Static_assert(expr, msg)
+#else
+/// C99 fallback: an array of negative size fails to compile
+#define EHSH_STATIC_ASSERT(expr, msg) extern char EhStaticAssert[(expr) ? 1 : -1]
+#endif /* __STDC_VERSION__ >= 201112L */
+
+#if EHSH_CFG_INDEX_WIDTH == 8
+EHSH_STATIC_ASSERT(EHSH_MAX_ARGS <= 15, "8-bit EHSH_CFG_INDEX_WIDTH only supports up to a maximum of 15 arguments");
+#else
+EHSH_STATIC_ASSERT(EHSH_MAX_ARGS <= EHSH_INDEX_MAX, "EHSH_MAX_ARGS exceeds EHSH_CFG_INDEX_WIDTH");
+#endif /* EHSH_CFG_INDEX_WIDTH == 8 */
+EHSH_STATIC_ASSERT(EHSH_CMDLINE_SIZE <= EHSH_INDEX_MAX, "EHSH_CMDLINE_SIZE exceeds EHSH_CFG_INDEX_WIDTH");
+EHSH_STATIC_ASSERT(EHSH_HISTORY_SIZE <= UINT16_MAX, "EHSH_HISTORY_SIZE must fit in 16 bits");
+EHSH_STATIC_ASSERT(EHSH_TYPEAHEAD_SIZE <= UINT16_MAX, "EHSH_TYPEAHEAD_SIZE must fit in 16 bits");
+#if EHSH_CFG_STATS
+EHSH_STATIC_ASSERT((EHSH_STATS_BUCKETS >= 1) && (EHSH_STATS_BUCKETS <= 33), "EHSH_STATS_BUCKETS must be 1 to 33");
+#endif /* EHSH_CFG_STATS */
+#if EHSH_CFG_FRAMED
+EHSH_STATIC_ASSERT((EHSH_FRAME_OUT_SIZE >= 1) && (EHSH_FRAME_OUT_SIZE <= UINT16_MAX - 4), "EHSH_FRAME_OUT_SIZE must be 1 to 65531");
+#if !EHSH_CFG_PLATFORM_TRANSPORT
+#error "EHSH_CFG_FRAMED captures output through EhShell.Transport; set EHSH_CFG_PLATFORM_TRANSPORT once the platform hooks honor it"
+#endif /* !EHSH_CFG_PLATFORM_TRANSPORT */
+#endif /* EHSH_CFG_FRAMED */
+
+/// EhShell.Escape: not in an escape sequence
+#define EHSH_ESCAPE_NONE 0
+/// EhShell.Escape: ESC received
+#define EHSH_ESCAPE_ESC 1
+/// EhShell.Escape: ESC [ (or ESC O) received; parameters may follow until the final byte
+#define EHSH_ESCAPE_CSI 2
+/// EhShell.Escape: past the first parameter, which is all that is kept
+#define EHSH_ESCAPE_CSI_MORE 3
+
+/// Bytes before & after each history entry holding its length
+#define EHSH_HISTORY_LENGTH sizeof(EhIndex_t)
+
+/// Largest number of bytes in a COBS block; its code byte is one more
+#define EHSH_COBS_RUN_MAX 254
+
+////////////////////////////////////////////////////////////////////////////////
+// $Globals
+////////////////////////////////////////////////////////////////////////////////
+#if defined(_MSC_VER)
+#pragma section("ehsh$a", read, write)
+#pragma section("ehsh$c", read, write)
+/// Sorts before any "ehsh$b" entry; zeroed, like any padding the linker adds
+__declspec(allocate("ehsh$a")) static EhCommand_t EhRegisteredStart[1];
+/// Sorts after any "ehsh$b" entry
+__declspec(allocate("ehsh$c")) static EhCommand_t EhRegisteredStop[1];
+#define EHSH_REGISTERED_START (&EhRegisteredStart[0])
+#define EHSH_REGISTERED_STOP (&EhRegisteredStop[0])
+#elif defined(__APPLE__)
+extern EhCommand_t EhRegisteredStart[] __asm("section$start$__DATA$ehsh_cmds");
+extern EhCommand_t EhRegisteredStop[] __asm("section$end$__DATA$ehsh_cmds");
+#define EHSH_REGISTERED_START (&EhRegisteredStart[0])
+#define EHSH_REGISTERED_STOP (&EhRegisteredStop[0])
+#elif defined(EHSH_REGISTER_SECTION)
+// Weak, as the linker only defines them if something was registered
+extern EhCommand_t __start_ehsh_cmds[] __attribute__((weak));
+extern EhCommand_t __stop_ehsh_cmds[] __attribute__((weak));
+#define EHSH_REGISTERED_START __start_ehsh_cmds
+#define EHSH_REGISTERED_STOP __stop_ehsh_cmds
+#endif /* _MSC_VER */
+
+#ifdef EHSH_REGISTERED_START
+/// Set once the registered commands have been sorted
+static bool EhRegisteredSorted = false;
+#endif /* EHSH_REGISTERED_START */
 
 ////////////////////////////////////////////////////////////////////////////////
 // $Prototypes
@@ -26,219 +92,2381 @@ static_assert(EHSH_MAX_ARGS <= 15, "ehsh currently only supports up to a maximum
  * calling its handler with tokenized args.
  *
  * @param self Shell whose current command line will be handled.
+ * @return `false` if a segment named no command or had invalid arguments
+ * (which has been reported).
  */
 static bool EhHandleCmdLine(EhShell_t* self);
 
+/** @brief Runs the command line's ';'-separated segments from
+ * EhShell.SegmentNext on, until one yields or fails, or the line ends.
+ *
+ * @param self Shell whose command line is being handled.
+ * @return `false` if a segment named no command or had invalid arguments
+ * (which has been reported).
+ */
+static bool EhRunSegments(EhShell_t* self);
+
+/** @brief Looks up the command named at start, then each subcommand named by
+ * the arguments after it, level by level.
+ *
+ * @param self Shell whose tokenized command line is looked up.
+ * @param start Offset into EhShell.CmdLine of the command's name.
+ * @param[out] depth Number of arguments naming subcommands.
+ * @param[out] root Optional; receives the top-level command.
+ * @return The deepest command found, or `NULL` if start names none.
+ */
+static const EhCommand_t* EhResolve(const EhShell_t* self, EhIndex_t start, EhIndex_t* depth, const EhCommand_t** root);
+
+/** @brief Validates & calls the command named by a tokenized segment.
+ *
+ * @param self Shell whose command line has been tokenized.
+ * @param start Offset into EhShell.CmdLine of the command's name.
+ * @return EHSH_FRAME_OK, EHSH_FRAME_NO_COMMAND or EHSH_FRAME_BAD_ARGS.
+ */
+static EhFrameStatus_t EhDispatch(EhShell_t* self, EhIndex_t start);
+
+/** @brief Calls a command's callback once.
+ *
+ * @param self Shell whose command line holds the command's arguments.
+ * @param cmd Command to call; it becomes EhShell.Running if it yields.
+ */
+static void EhCall(EhShell_t* self, const EhCommand_t* cmd);
+
 /** @brief Saves the indices of the arguments,
  * replacing spaces in EhShell.CmdLine with '\0'.
  *
  * @param self Shell whose arguments shall be tokenized.
+ * @param start Offset into EhShell.CmdLine of the segment to tokenize.
  */
-static void EhTokenize(EhShell_t* self);
+static void EhTokenize(EhShell_t* self, EhIndex_t start);
+
+#if EHSH_HISTORY_SIZE > 0
+/** @brief Saves the command line as the newest history entry, evicting the
+ * oldest entries as needed to make room.
+ *
+ * @param self Shell whose command line is saved.
+ */
+static void EhHistoryAppend(EhShell_t* self);
+#endif /* EHSH_HISTORY_SIZE > 0 */
 
 ////////////////////////////////////////////////////////////////////////////////
 // $Functions
 ////////////////////////////////////////////////////////////////////////////////
-static void EhOnNewline(EhShell_t* self)
+/** @brief Orders command names as per `strncmp`, with `NULL` names before all others.
+ *
+ * @param name Command name, possibly `NULL`.
+ * @param str String to compare against.
+ * @param length Maximum number of characters to compare.
+ * @return <0, 0, or >0 if name is less than, equal to, or greater than str.
+ */
+static int EhCompareName(const char* name, const char* str, size_t length)
 {
-  if (self->Tty)
+  int cmp = -1;
+  if (name != NULL)
   {
-    EhPutNewline(self);
+    cmp = (str != NULL) ? strncmp(name, str, length) : 1;
   }
-  if (!EhHandleCmdLine(self))
+  else if (str == NULL)
   {
-    EhPutStr(self, "No such command \"");
-    EhPutStr(self, self->CmdLine);
-    EhPutChar(self, '"');
+    cmp = 0;
+  }
+  return cmp;
+}
+
+/** @brief Finds the first of a sorted table's commands for which
+ * EhCompareName() against str is not less than bias (0 for lower bound, 1 for
+ * upper bound).
+ */
+static uint16_t EhBisect(const EhCommand_t* cmds, uint16_t count, const char* str, size_t length, int bias)
+{
+  uint16_t lo = 0;
+  uint16_t hi = count;
+
+  while (lo < hi)
+  {
+    const uint16_t mid = lo + ((hi - lo) / 2);
+    if (EhCompareName(cmds[mid].Name, str, length) < bias)
+    {
+      lo = mid + 1;
+    }
+    else
+    {
+      hi = mid;
+    }
+  }
+
+  return lo;
+}
+
+static void EhPutNoSuchCommand(EhShell_t* self, EhIndex_t start)
+{
+  EhIndex_t                depth = 0;
+  const EhCommand_t* const cmd   = EhResolve(self, start, &depth, NULL);
+
+  EhPutStr(self, "No such command \"");
+  EhPutStr(self, &self->CmdLine[start]);
+  // The subcommands found, then the one that wasn't
+  for (EhIndex_t i = 0; (cmd != NULL) && (i <= depth) && (i < self->ArgCount); ++i)
+  {
+    EhPutChar(self, ' ');
+    EhPutStr(self, &self->CmdLine[self->ArgIdx[i]]);
+  }
+  EhPutChar(self, '"');
+  EhPutNewline(self);
+}
+
+/** @brief Wraps up the command line once its command has finished: prompts
+ * for the next one and clears it.
+ */
+static void EhFinishLine(EhShell_t* self)
+{
+  if ((self->Interrupted) && (self->Tty))
+  {
+    EhPutStr(self, "^C");
     EhPutNewline(self);
   }
-  if (self->Tty)
+  if ((self->Tty) && (!self->Framed))
   {
     EhPutStr(self, EHSH_PROMPT);
   }
+  EhFlush(self);
 
-  // Reset
-  memset(&self->CmdLine[0], 0, sizeof(self->CmdLine));
-  self->Cursor = 0;
+  // Reset; everything from Length on is already '\0'
+  memset(&self->CmdLine[0], 0, self->Length);
+  self->Cursor      = 0;
+  self->Length      = 0;
+  self->Running     = NULL;
+  self->Interrupted = 0;
+  self->Segment     = 0;
+  self->SegmentNext = 0;
 }
 
-static void EhOnBackspace(EhShell_t* self)
+static void EhOnNewline(EhShell_t* self)
 {
-  if (self->Cursor > 0)
+  if (self->Tty)
   {
-    self->CmdLine[self->Cursor - 1] = '\0';
-    --self->Cursor;
-    if (self->Tty)
-    {
-      // Move cursor left, print space, move cursor left
-      EhPutStr(self, EHSH_BACKSPACE " " EHSH_BACKSPACE);
-    }
+    EhPutNewline(self);
+#if EHSH_HISTORY_SIZE > 0
+    EhHistoryAppend(self);
+#endif /* EHSH_HISTORY_SIZE > 0 */
+  }
+  (void)EhHandleCmdLine(self);
+  if (self->Running == NULL)
+  {
+    EhFinishLine(self);
   }
 }
 
-static void EhOnTab(EhShell_t* self)
+/** @brief Recomputes the range of commands matching the command line so far.
+ * Each finished word naming a group moves completion into its subcommands.
+ */
+static void EhComplete(EhShell_t* self)
 {
-  uint8_t matches   = 0;
-  uint8_t lastMatch = 0;
+  const EhCommand_t* level = self->Cmds;
+  uint16_t           count = self->CmdCount;
+  EhIndex_t          start = 0;
+  const char*        space = (const char*)memchr(&self->CmdLine[0], ' ', self->Length);
 
-  for (size_t i = 0; (i < self->CmdCount); ++i)
+  while ((space != NULL) && (level != NULL))
   {
-    if ((self->Cmds[i].Name != NULL) && (strncmp(self->CmdLine, self->Cmds[i].Name, self->Cursor) == 0))
+    const size_t       length = (size_t)(space - &self->CmdLine[start]);
+    const uint16_t     index  = EhBisect(level, count, &self->CmdLine[start], length, 0);
+    const EhCommand_t* group  = NULL;
+    if ((index < count) && (EhCompareName(level[index].Name, &self->CmdLine[start], length) == 0) &&
+        (level[index].Name[length] == '\0') && (level[index].Children != NULL))
     {
-      ++matches;
-      lastMatch = i;
-      EhPutNewline(self);
-      EhPutStr(self, self->Cmds[i].Name);
+      group = &level[index];
     }
+
+    // Past anything but a group's name, there's nothing left to complete
+    level = (group != NULL) ? group->Children : NULL;
+    count = (group != NULL) ? group->ChildCount : 0;
+    start = (EhIndex_t)(start + length + 1);
+    space = (const char*)memchr(&self->CmdLine[start], ' ', (size_t)(self->Length - start));
   }
 
-  if (matches)
+  self->Level      = level;
+  self->LevelCount = count;
+  self->LevelStart = start;
+  self->MatchFirst = 0;
+  self->MatchCount = 0;
+  if (level != NULL)
   {
-    if (matches == 1)
-    {
-      strncpy(&self->CmdLine[0], self->Cmds[lastMatch].Name, sizeof(self->CmdLine));
-      self->Cursor = strnlen(&self->CmdLine[0], EHSH_CMDLINE_SIZE);
-    }
-    EhPutNewline(self);
-    EhPutStr(self, EHSH_PROMPT);
-    EhPutStr(self, self->CmdLine);
+    const size_t length = (size_t)(self->Length - start);
+    self->MatchFirst    = EhBisect(level, count, &self->CmdLine[start], length, 0);
+    self->MatchCount    = EhBisect(level, count, &self->CmdLine[start], length, 1) - self->MatchFirst;
   }
 }
 
-static void EhOnChar(EhShell_t* self, char chr)
+/** @brief Narrows the range of matching commands to those with chr at depth.
+ * All commands in range share the first depth characters, so in a sorted table
+ * the characters at depth are themselves sorted.
+ *
+ * @param self Shell whose completion state is narrowed.
+ * @param depth Position of chr in the command line.
+ * @param chr Character just appended to the command line.
+ */
+static void EhNarrow(EhShell_t* self, size_t depth, char chr)
 {
-  // If the cursor is at the end of the buffer
-  if (self->Cursor >= EHSH_CMDLINE_SIZE)
+  const uint8_t  key = (uint8_t)chr;
+  depth -= self->LevelStart;
+  const uint16_t end = self->MatchFirst + self->MatchCount;
+  uint16_t       lo  = self->MatchFirst;
+  uint16_t       hi  = end;
+
+  while (lo < hi)
   {
-    // Move the cursor to the last valid position
-    self->Cursor = EHSH_CMDLINE_SIZE - 1;
-    // and Send a backspace to the TTY
-    if (self->Tty)
+    const uint16_t mid = lo + ((hi - lo) / 2);
+    if ((uint8_t)self->Level[mid].Name[depth] < key)
     {
-      EhPutChar(self, EHSH_ASCII_BS);
+      lo = mid + 1;
+    }
+    else
+    {
+      hi = mid;
     }
   }
+  self->MatchFirst = lo;
 
-  self->CmdLine[self->Cursor] = chr;
-  if (self->Tty)
+  hi = end;
+  while (lo < hi)
   {
-    EhPutChar(self, chr);
+    const uint16_t mid = lo + ((hi - lo) / 2);
+    if ((uint8_t)self->Level[mid].Name[depth] <= key)
+    {
+      lo = mid + 1;
+    }
+    else
+    {
+      hi = mid;
+    }
   }
+  self->MatchCount = lo - self->MatchFirst;
+}
+
+void EhPutDecimal(EhShell_t* self, uint32_t value)
+{
+  char  digits[11];  // 4294967295 + '\0'
+  char* digit = &digits[sizeof(digits) - 1];
 
-  ++self->Cursor;
+  *digit = '\0';
+  do
+  {
+    *--digit = (char)('0' + (value % 10));
+    value /= 10;
+  } while (value != 0);
+
+  EhPutStr(self, digit);
 }
 
-EhShell_t* EhInit(EhShell_t* self, const EhConfig_t* config)
+/** @brief Outputs chr count times, e.g. to pad a field. */
+static void EhPutRepeat(EhShell_t* self, char chr, size_t count)
 {
-  if ((self != NULL) && (config != NULL))
+  for (size_t i = 0; i < count; ++i)
   {
-    memset(self, 0, sizeof(*self));
-    self->Cmds     = config->Commands;
-    self->CmdCount = config->CommandCount;
-    self->Eol      = config->Eol;
-    self->Tty      = config->Tty;
-    self->Cr       = config->Cr;
-    self->Lf       = config->Lf;
+    EhPutChar(self, chr);
   }
-  return self;
 }
 
-void EhDeInit(EhShell_t* self)
+/** @brief Formats value backwards from end, with a point before the last
+ * decimals digits (padded with zeros, e.g. "0.05").
+ *
+ * @param end Last byte of the buffer, which receives the '\0'.
+ * @param digits Digits of the base, e.g. "0123456789".
+ * @return First character of the number.
+ */
+static char* EhFormatNumber(char* end, unsigned long value, unsigned base, const char* digits, unsigned decimals)
 {
-  (void)self;
+  char*    out   = end;
+  unsigned count = 0;
+
+  *out = '\0';
+  do
+  {
+    if ((count == decimals) && (decimals > 0))
+    {
+      *--out = '.';
+    }
+    *--out = digits[value % base];
+    value /= base;
+    ++count;
+  } while ((value != 0) || (count <= decimals));
+
+  return out;
 }
 
-void EhExec(EhShell_t* self)
+void EhPrintf(EhShell_t* self, const char* fmt, ...)
 {
-  if (self->Tty)
+  va_list args;
+  va_start(args, fmt);
+  EhVPrintf(self, fmt, args);
+  va_end(args);
+}
+
+/** @brief Prints one conversion of EhPrintf(), e.g. "%08lx".
+ *
+ * @param fmt Just past the '%'.
+ * @param args Arguments, advanced past the one printed.
+ * @return Just past the conversion.
+ */
+static const char* EhPrintConversion(EhShell_t* self, const char* fmt, va_list* args)
+{
+  char     buf[24];  // 64-bit ULONG_MAX is 20 digits, plus '.' & '\0'
+  bool     left     = false;
+  bool     zero     = false;
+  bool     negative = false;
+  bool     wide     = false;
+  size_t   width    = 0;
+  unsigned decimals = 0;
+
+  while ((*fmt == '-') || (*fmt == '0'))
   {
-    EhPutStr(self, EHSH_PROMPT);
+    left = left || (*fmt == '-');
+    zero = zero || (*fmt == '0');
+    ++fmt;
+  }
+  while ((*fmt >= '0') && (*fmt <= '9'))
+  {
+    width = (width * 10) + (size_t)(*fmt - '0');
+    ++fmt;
+  }
+  if (*fmt == '.')
+  {
+    ++fmt;
+    while ((*fmt >= '0') && (*fmt <= '9'))
+    {
+      decimals = (decimals * 10) + (unsigned)(*fmt - '0');
+      ++fmt;
+    }
+    decimals = (decimals > 9) ? 9 : decimals;
+  }
+  if (*fmt == 'l')
+  {
+    wide = true;
+    ++fmt;
   }
 
-  do
+  const char  conv = *fmt;
+  const char* text = &buf[0];
+  char*       end  = &buf[sizeof(buf) - 1];
+  fmt += (conv != '\0') ? 1 : 0;
+  switch (conv)
+  {
+    case 'd':
+    {
+      const long value = wide ? va_arg(*args, long) : (long)va_arg(*args, int);
+      negative         = value < 0;
+      text = EhFormatNumber(end, negative ? (0UL - (unsigned long)value) : (unsigned long)value, 10, "0123456789", decimals);
+      break;
+    }
+    case 'u':
+      text = EhFormatNumber(end, wide ? va_arg(*args, unsigned long) : va_arg(*args, unsigned), 10, "0123456789", decimals);
+      break;
+    case 'x':
+      text = EhFormatNumber(end, wide ? va_arg(*args, unsigned long) : va_arg(*args, unsigned), 16, "0123456789abcdef", 0);
+      break;
+    case 'X':
+      text = EhFormatNumber(end, wide ? va_arg(*args, unsigned long) : va_arg(*args, unsigned), 16, "0123456789ABCDEF", 0);
+      break;
+    case 's':
+      text = va_arg(*args, const char*);
+      text = (text != NULL) ? text : "(null)";
+      zero = false;
+      break;
+    case 'c':
+      buf[0] = (char)va_arg(*args, int);
+      buf[1] = '\0';
+      zero   = false;
+      break;
+    default:
+      // '%', or not supported: print it as is
+      buf[0] = conv;
+      buf[1] = '\0';
+      zero   = false;
+      break;
+  }
+
+  const size_t length = strlen(text) + (negative ? 1 : 0);
+  const size_t pad    = (width > length) ? (width - length) : 0;
+  if ((!left) && (!zero))
+  {
+    EhPutRepeat(self, ' ', pad);
+  }
+  if (negative)
+  {
+    EhPutChar(self, '-');
+  }
+  if ((!left) && (zero))
+  {
+    EhPutRepeat(self, '0', pad);
+  }
+  EhPutStr(self, text);
+  if (left)
   {
-    char chr = EhGetChar(self);
+    EhPutRepeat(self, ' ', pad);
+  }
 
-    if (chr == '\n')
+  return fmt;
+}
+
+void EhVPrintf(EhShell_t* self, const char* fmt, va_list args)
+{
+  char    text[16];  // Literal text is output in chunks, not per character
+  size_t  length = 0;
+  va_list rest;
+
+  va_copy(rest, args);
+  while (*fmt != '\0')
+  {
+    const bool conversion = *fmt == '%';
+    if (!conversion)
     {
-      if (self->Eol == EHSH_EOL_LF)
-      {
-        EhOnNewline(self);
-      }
+      text[length] = *fmt;
+      ++length;
+      ++fmt;
     }
-    else if (chr == '\r')
+    if ((length > 0) && ((conversion) || (length == (sizeof(text) - 1)) || (*fmt == '\0')))
     {
-      if (self->Eol == EHSH_EOL_CR)
-      {
-        EhOnNewline(self);
-      }
+      text[length] = '\0';
+      EhPutStr(self, text);
+      length = 0;
     }
-    else if (chr == EHSH_ASCII_EOT)
+    if (conversion)
     {
-      self->Stop = 1;
+      fmt = EhPrintConversion(self, fmt + 1, &rest);
     }
-    else if ((chr == EHSH_ASCII_DEL) || (chr == EHSH_ASCII_BS))
+  }
+  va_end(rest);
+}
+
+void EhPutHelp(EhShell_t* self, const char* help)
+{
+  const EhHelpDict_t* dict = self->HelpDict;
+  char                text[16];  // Expanded text is output in chunks, not per character
+  size_t              length = 0;
+
+  while (*help != '\0')
+  {
+    const uint8_t code  = (uint8_t)*help;
+    const char*   word  = help;
+    size_t        count = 1;
+    if ((dict != NULL) && (code >= 0x80U) && ((code - 0x80U) < dict->Count))
     {
-      EhOnBackspace(self);
+      word  = &dict->Words[dict->Offsets[code - 0x80U]];
+      count = dict->Offsets[code - 0x80U + 1U] - dict->Offsets[code - 0x80U];
     }
-    else if (chr == '\t')
+    ++help;
+    for (size_t i = 0; i < count; ++i)
     {
-      if (self->Tty)
+      text[length] = word[i];
+      ++length;
+      if (length == (sizeof(text) - 1))
       {
-        EhOnTab(self);
+        text[length] = '\0';
+        EhPutStr(self, text);
+        length = 0;
       }
     }
-    else if (chr != (char)-1)
+  }
+
+  // Whatever is left, even if the last word expanded to nothing
+  if (length > 0)
+  {
+    text[length] = '\0';
+    EhPutStr(self, text);
+  }
+}
+
+#if EHSH_HISTORY_SIZE > 0
+/** @brief Copies length bytes out of the history ring, starting at offset & wrapping around. */
+static void EhHistoryRead(const EhShell_t* self, size_t offset, void* dst, size_t length)
+{
+  offset %= EHSH_HISTORY_SIZE;
+  const size_t first = ((offset + length) <= EHSH_HISTORY_SIZE) ? length : (EHSH_HISTORY_SIZE - offset);
+  memcpy(dst, &self->History[offset], first);
+  memcpy((char*)dst + first, &self->History[0], length - first);
+}
+
+/** @brief Copies length bytes into the history ring, starting at offset & wrapping around. */
+static void EhHistoryWrite(EhShell_t* self, size_t offset, const void* src, size_t length)
+{
+  offset %= EHSH_HISTORY_SIZE;
+  const size_t first = ((offset + length) <= EHSH_HISTORY_SIZE) ? length : (EHSH_HISTORY_SIZE - offset);
+  memcpy(&self->History[offset], src, first);
+  memcpy(&self->History[0], (const char*)src + first, length - first);
+}
+
+/** @brief Reads the length stored before or after a history entry. */
+static EhIndex_t EhHistoryLength(const EhShell_t* self, size_t offset)
+{
+  EhIndex_t length;
+  EhHistoryRead(self, offset, &length, sizeof(length));
+  return length;
+}
+
+/** @brief Whether the newest history entry is the same as the command line. */
+static bool EhHistoryRepeats(const EhShell_t* self)
+{
+  const size_t tail   = self->HistoryHead + self->HistoryUsed;
+  bool         repeat = false;
+
+  if ((self->HistoryUsed > 0) && (EhHistoryLength(self, tail - EHSH_HISTORY_LENGTH) == self->Length))
+  {
+    const size_t start = tail - EHSH_HISTORY_LENGTH - self->Length;
+    repeat             = true;
+    for (size_t i = 0; (repeat) && (i < self->Length); ++i)
     {
-      EhOnChar(self, chr);
+      repeat = self->History[(start + i) % EHSH_HISTORY_SIZE] == self->CmdLine[i];
     }
-  } while (!self->Stop);
+  }
+
+  return repeat;
 }
 
-void EhPutNewline(EhShell_t* self)
+static void EhHistoryAppend(EhShell_t* self)
 {
-  if (self->Cr)
+  const EhIndex_t length = self->Length;
+  const size_t    size   = length + (2 * EHSH_HISTORY_LENGTH);
+
+  if ((length > 0) && (size <= EHSH_HISTORY_SIZE) && (!EhHistoryRepeats(self)))
+  {
+    while ((size_t)(EHSH_HISTORY_SIZE - self->HistoryUsed) < size)
+    {
+      const size_t oldest = EhHistoryLength(self, self->HistoryHead) + (2 * EHSH_HISTORY_LENGTH);
+      self->HistoryHead   = (uint16_t)((self->HistoryHead + oldest) % EHSH_HISTORY_SIZE);
+      self->HistoryUsed   = (uint16_t)(self->HistoryUsed - oldest);
+    }
+
+    const size_t tail = self->HistoryHead + self->HistoryUsed;
+    EhHistoryWrite(self, tail, &length, EHSH_HISTORY_LENGTH);
+    EhHistoryWrite(self, tail + EHSH_HISTORY_LENGTH, self->CmdLine, length);
+    EhHistoryWrite(self, tail + EHSH_HISTORY_LENGTH + length, &length, EHSH_HISTORY_LENGTH);
+    self->HistoryUsed = (uint16_t)(self->HistoryUsed + size);
+  }
+  self->HistoryBack = 0;
+}
+
+/** @brief Replaces the command line with the recalled history entry (or
+ * clears it if none is recalled), then redraws the line in one go.
+ */
+static void EhHistoryShow(EhShell_t* self)
+{
+  memset(&self->CmdLine[0], 0, self->Length);
+  self->Length = 0;
+  if (self->HistoryBack > 0)
+  {
+    const size_t start = self->HistoryHead + self->HistoryUsed - self->HistoryBack;
+    self->Length       = EhHistoryLength(self, start);
+    EhHistoryRead(self, start + EHSH_HISTORY_LENGTH, self->CmdLine, self->Length);
+  }
+  self->Cursor = self->Length;
+  EhComplete(self);
+
+  if (self->Tty)
   {
+    // Return to the start of the line, reprint it, then erase whatever is left of the old one
     EhPutChar(self, '\r');
+    EhPutStr(self, EHSH_PROMPT);
+    EhPutStr(self, self->CmdLine);
+    EhPutStr(self, "\x1B[K");
   }
-  if (self->Lf)
+}
+
+/** @brief Recalls the entry before the one currently recalled, if any. */
+static void EhHistoryUp(EhShell_t* self)
+{
+  if (self->HistoryBack < self->HistoryUsed)
   {
-    EhPutChar(self, '\n');
+    const size_t end = self->HistoryHead + self->HistoryUsed - self->HistoryBack;
+    self->HistoryBack = (uint16_t)(self->HistoryBack + EhHistoryLength(self, end - EHSH_HISTORY_LENGTH) + (2 * EHSH_HISTORY_LENGTH));
+    EhHistoryShow(self);
   }
 }
 
-static bool EhHandleCmdLine(EhShell_t* self)
+/** @brief Recalls the entry after the one currently recalled, or clears the line after the newest. */
+static void EhHistoryDown(EhShell_t* self)
 {
-  bool found = false;
-  EhTokenize(self);
+  if (self->HistoryBack > 0)
+  {
+    const size_t start = self->HistoryHead + self->HistoryUsed - self->HistoryBack;
+    self->HistoryBack  = (uint16_t)(self->HistoryBack - EhHistoryLength(self, start) - (2 * EHSH_HISTORY_LENGTH));
+    EhHistoryShow(self);
+  }
+}
+#endif /* EHSH_HISTORY_SIZE > 0 */
 
-  for (size_t i = 0; ((!found) && (i < self->CmdCount)); ++i)
+/** @brief Moves the terminal's cursor left, in as few bytes as possible. */
+static void EhMoveLeft(EhShell_t* self, size_t count)
+{
+  if (!self->Tty)
+  {
+    // Nothing to draw
+  }
+  else if (count > 4)
+  {
+    EhPutStr(self, "\x1B[");
+    EhPutDecimal(self, (uint32_t)count);
+    EhPutChar(self, 'D');
+  }
+  else
   {
-    if ((self->Cmds[i].Name != NULL) && (strncmp(self->Cmds[i].Name, self->CmdLine, EHSH_CMDLINE_SIZE) == 0))
+    for (size_t i = 0; i < count; ++i)
     {
-      found = true;
-      if (self->Cmds[i].Callback != NULL)
-      {
-        self->Cmds[i].Callback(self);
-      }
+      EhPutChar(self, EHSH_ASCII_BS);
+    }
+  }
+}
+
+/** @brief Moves the terminal's cursor right from EhShell.Cursor, in as few
+ * bytes as possible; short moves just reprint the characters passed over.
+ */
+static void EhMoveRight(EhShell_t* self, size_t count)
+{
+  if (!self->Tty)
+  {
+    // Nothing to draw
+  }
+  else if (count > 4)
+  {
+    EhPutStr(self, "\x1B[");
+    EhPutDecimal(self, (uint32_t)count);
+    EhPutChar(self, 'C');
+  }
+  else
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      EhPutChar(self, self->CmdLine[self->Cursor + i]);
+    }
+  }
+}
+
+/** @brief Deletes CmdLine[from, to), where the cursor is at either end,
+ * leaving the cursor at from. Only the text after the deletion is redrawn,
+ * then blanked past its new end.
+ */
+static void EhErase(EhShell_t* self, EhIndex_t from, EhIndex_t to)
+{
+  const size_t count = (size_t)(to - from);
+  const size_t tail  = (size_t)(self->Length - to);
+
+  memmove(&self->CmdLine[from], &self->CmdLine[to], tail);
+  memset(&self->CmdLine[from + tail], 0, count);
+  self->Length = (EhIndex_t)(self->Length - count);
+
+  EhMoveLeft(self, self->Cursor - from);
+  if ((self->Tty) && (tail > 0))
+  {
+    EhPutStr(self, &self->CmdLine[from]);
+  }
+  if ((self->Tty) && (count > 3))
+  {
+    EhPutStr(self, "\x1B[K");
+    EhMoveLeft(self, tail);
+  }
+  else if (self->Tty)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      EhPutChar(self, ' ');
+    }
+    EhMoveLeft(self, tail + count);
+  }
+
+  self->Cursor = from;
+  EhComplete(self);
+}
+
+/** @brief Inserts chr at the cursor, mid-line; only the text from the cursor on is redrawn. */
+static void EhInsert(EhShell_t* self, char chr)
+{
+  if (self->Length < EHSH_CMDLINE_SIZE)
+  {
+    const size_t tail = (size_t)(self->Length - self->Cursor);
+    memmove(&self->CmdLine[self->Cursor + 1], &self->CmdLine[self->Cursor], tail);
+    self->CmdLine[self->Cursor] = chr;
+    ++self->Length;
+    if (self->Tty)
+    {
+      EhPutStr(self, &self->CmdLine[self->Cursor]);
+      EhMoveLeft(self, tail);
+    }
+    ++self->Cursor;
+    EhComplete(self);
+  }
+}
+
+static void EhOnLeft(EhShell_t* self)
+{
+  if (self->Cursor > 0)
+  {
+    EhMoveLeft(self, 1);
+    --self->Cursor;
+  }
+}
+
+static void EhOnRight(EhShell_t* self)
+{
+  if (self->Cursor < self->Length)
+  {
+    EhMoveRight(self, 1);
+    ++self->Cursor;
+  }
+}
+
+static void EhOnHome(EhShell_t* self)
+{
+  EhMoveLeft(self, self->Cursor);
+  self->Cursor = 0;
+}
+
+static void EhOnEnd(EhShell_t* self)
+{
+  EhMoveRight(self, self->Length - self->Cursor);
+  self->Cursor = self->Length;
+}
+
+static void EhOnDelete(EhShell_t* self)
+{
+  if (self->Cursor < self->Length)
+  {
+    EhErase(self, self->Cursor, (EhIndex_t)(self->Cursor + 1));
+  }
+}
+
+static void EhOnBackspace(EhShell_t* self)
+{
+  if (self->Cursor > 0)
+  {
+    EhErase(self, (EhIndex_t)(self->Cursor - 1), self->Cursor);
+  }
+}
+
+/** @brief Erases the word before the cursor, along with any spaces after it. */
+static void EhOnEraseWord(EhShell_t* self)
+{
+  EhIndex_t start = self->Cursor;
+  while ((start > 0) && (self->CmdLine[start - 1] == ' '))
+  {
+    --start;
+  }
+  while ((start > 0) && (self->CmdLine[start - 1] != ' '))
+  {
+    --start;
+  }
+  EhErase(self, start, self->Cursor);
+}
+
+/** @brief Handles editing keys sent as control characters; others are ignored. */
+static void EhOnControl(EhShell_t* self, char chr)
+{
+  switch (chr)
+  {
+    case EHSH_ASCII_CTRL_A:
+      EhOnHome(self);
+      break;
+    case EHSH_ASCII_CTRL_B:
+      EhOnLeft(self);
+      break;
+    case EHSH_ASCII_CTRL_E:
+      EhOnEnd(self);
+      break;
+    case EHSH_ASCII_CTRL_F:
+      EhOnRight(self);
+      break;
+    case EHSH_ASCII_CTRL_K:
+      EhErase(self, self->Cursor, self->Length);
+      break;
+    case EHSH_ASCII_CTRL_U:
+      EhErase(self, 0, self->Cursor);
+      break;
+    case EHSH_ASCII_CTRL_W:
+      EhOnEraseWord(self);
+      break;
+    default:
+      break;
+  }
+}
+
+/** @brief Acts on the final byte of a CSI (`ESC [`) or SS3 (`ESC O`) sequence. */
+static void EhOnEscapeFinal(EhShell_t* self, char chr)
+{
+  switch (chr)
+  {
+#if EHSH_HISTORY_SIZE > 0
+    case 'A':
+      EhHistoryUp(self);
+      break;
+    case 'B':
+      EhHistoryDown(self);
+      break;
+#endif /* EHSH_HISTORY_SIZE > 0 */
+    case 'C':
+      EhOnRight(self);
+      break;
+    case 'D':
+      EhOnLeft(self);
+      break;
+    case 'H':
+      EhOnHome(self);
+      break;
+    case 'F':
+      EhOnEnd(self);
+      break;
+    case '~':
+      // VT220-style keys: ESC [ <n> ~
+      if ((self->EscapeParam == 1) || (self->EscapeParam == 7))
+      {
+        EhOnHome(self);
+      }
+      else if ((self->EscapeParam == 4) || (self->EscapeParam == 8))
+      {
+        EhOnEnd(self);
+      }
+      else if (self->EscapeParam == 3)
+      {
+        EhOnDelete(self);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+/** @brief Advances through a terminal escape sequence, acting on it once complete.
+ * Unrecognized sequences are swallowed rather than typed into the command line.
+ */
+static void EhOnEscape(EhShell_t* self, char chr)
+{
+  if (self->Escape == EHSH_ESCAPE_ESC)
+  {
+    self->Escape      = ((chr == '[') || (chr == 'O')) ? EHSH_ESCAPE_CSI : EHSH_ESCAPE_NONE;
+    self->EscapeParam = 0;
+  }
+  else if ((chr >= '@') && (chr <= '~'))
+  {
+    self->Escape = EHSH_ESCAPE_NONE;
+    EhOnEscapeFinal(self, chr);
+  }
+  else if ((self->Escape == EHSH_ESCAPE_CSI) && (chr >= '0') && (chr <= '9'))
+  {
+    const unsigned param = (self->EscapeParam * 10U) + (unsigned)(chr - '0');
+    self->EscapeParam    = (uint8_t)((param > UINT8_MAX) ? UINT8_MAX : param);
+  }
+  else
+  {
+    // Any further parameters or intermediate bytes are ignored
+    self->Escape = EHSH_ESCAPE_CSI_MORE;
+  }
+}
+
+static void EhOnTab(EhShell_t* self)
+{
+  if (self->Length == 0)
+  {
+    EhComplete(self);
+  }
+
+  // Only complete at the end of the line
+  if ((self->MatchCount > 0) && (self->Cursor == self->Length))
+  {
+    // Sorted, so the longest prefix common to all matches is that of the first & last
+    const char*  first  = self->Level[self->MatchFirst].Name;
+    const char*  last   = self->Level[self->MatchFirst + self->MatchCount - 1].Name;
+    const size_t typed  = (size_t)(self->Length - self->LevelStart);
+    size_t       common = typed;
+    while (((self->LevelStart + common) < EHSH_CMDLINE_SIZE) && (first[common] != '\0') && (first[common] == last[common]))
+    {
+      ++common;
+    }
+
+    if (common > typed)
+    {
+      // Fill in place; only the new characters go over the wire
+      memcpy(&self->CmdLine[self->Length], &first[typed], common - typed);
+      EhPutStr(self, &self->CmdLine[self->Length]);
+      self->Length = (EhIndex_t)(self->LevelStart + common);
+      self->Cursor = self->Length;
+    }
+    else if (self->MatchCount > 1)
+    {
+      EhPutNewline(self);
+      if (self->MatchCount > EHSH_TAB_LIST_MAX)
+      {
+        EhPutDecimal(self, self->MatchCount);
+        EhPutStr(self, " matches");
+        EhPutNewline(self);
+      }
+      else
+      {
+        for (uint16_t i = self->MatchFirst; i < (self->MatchFirst + self->MatchCount); ++i)
+        {
+          EhPutStr(self, self->Level[i].Name);
+          EhPutNewline(self);
+        }
+      }
+      EhPutStr(self, EHSH_PROMPT);
+      EhPutStr(self, self->CmdLine);
+    }
+  }
+}
+
+static void EhOnChar(EhShell_t* self, char chr)
+{
+  if (self->Cursor < self->Length)
+  {
+    EhInsert(self, chr);
+  }
+  else
+  {
+    const bool append = (self->Cursor > 0) && (self->Cursor < EHSH_CMDLINE_SIZE);
+
+    // If the cursor is at the end of the buffer
+    if (self->Cursor >= EHSH_CMDLINE_SIZE)
+    {
+      // Move the cursor to the last valid position
+      self->Cursor = EHSH_CMDLINE_SIZE - 1;
+      // and Send a backspace to the TTY
+      if (self->Tty)
+      {
+        EhPutChar(self, EHSH_ASCII_BS);
+      }
+    }
+
+    self->CmdLine[self->Cursor] = chr;
+    if (self->Tty)
+    {
+      EhPutChar(self, chr);
+    }
+
+    ++self->Cursor;
+    self->Length = self->Cursor;
+
+    // A space may finish a group's name, moving completion into it
+    if ((append) && (chr != ' '))
+    {
+      EhNarrow(self, self->Cursor - 1, chr);
+    }
+    else
+    {
+      EhComplete(self);
+    }
+  }
+}
+
+/** @brief Appends a run of plain characters; the cursor must be at the end of the line. */
+static void EhOnChars(EhShell_t* self, const char* str, size_t length)
+{
+  // Copy as much as fits in bulk; overflowing characters take the slow path
+  const size_t room  = EHSH_CMDLINE_SIZE - self->Cursor;
+  const size_t count = (length < room) ? length : room;
+
+  memcpy(&self->CmdLine[self->Cursor], str, count);
+  if ((self->Tty) && (count > 0))
+  {
+    // Everything after the cursor is '\0', so the run is already terminated
+    EhPutStr(self, &self->CmdLine[self->Cursor]);
+  }
+  self->Cursor = (EhIndex_t)(self->Cursor + count);
+  self->Length = self->Cursor;
+  EhComplete(self);
+
+  for (size_t i = count; i < length; ++i)
+  {
+    EhOnChar(self, str[i]);
+  }
+}
+
+static inline bool EhIsPlain(char chr)
+{
+  return ((unsigned char)chr >= ' ') && (chr != EHSH_ASCII_DEL) && (chr != (char)-1);
+}
+
+/** @brief Measures the run of plain characters (those handled by EhOnChar())
+ * at the start of buf, a machine word at a time.
+ *
+ * @param buf Bytes to scan.
+ * @param length Number of bytes in buf.
+ * @return Number of leading bytes that need no special handling.
+ */
+static size_t EhScanPlain(const char* buf, size_t length)
+{
+  const size_t ones  = (size_t)-1 / 0xFF;  // 0x0101...
+  const size_t highs = ones * 0x80;        // 0x8080...
+  bool         plain = true;
+  size_t       i     = 0;
+
+  while ((plain) && ((i + sizeof(size_t)) <= length))
+  {
+    size_t word;
+    memcpy(&word, &buf[i], sizeof(word));
+
+    // Each term flags the high bit of any byte that is < ' ', DEL, or 0xFF respectively
+    const size_t del     = word ^ (ones * EHSH_ASCII_DEL);
+    const size_t control = (word - (ones * ' ')) & ~word;
+    const size_t erase   = (del - ones) & ~del;
+    const size_t invalid = (~word - ones) & word;
+
+    if (((control | erase | invalid) & highs) != 0)
+    {
+      plain = false;
+    }
+    else
+    {
+      i += sizeof(word);
+    }
+  }
+
+  while ((i < length) && (EhIsPlain(buf[i])))
+  {
+    ++i;
+  }
+
+  return i;
+}
+
+/** @brief Moves a heap's root down until neither child is greater than it. */
+static void EhSiftDown(EhCommand_t* cmds, uint16_t root, uint16_t count)
+{
+  bool     sifting = true;
+  uint32_t child   = (2U * (uint32_t)root) + 1U;
+
+  while ((sifting) && (child < count))
+  {
+    if (((child + 1U) < count) && (EhCompareName(cmds[child].Name, cmds[child + 1U].Name, EHSH_CMDLINE_SIZE) < 0))
+    {
+      ++child;
+    }
+    if (EhCompareName(cmds[root].Name, cmds[child].Name, EHSH_CMDLINE_SIZE) < 0)
+    {
+      const EhCommand_t swap = cmds[root];
+      cmds[root]             = cmds[child];
+      cmds[child]            = swap;
+      root                   = (uint16_t)child;
+      child                  = (2U * child) + 1U;
+    }
+    else
+    {
+      sifting = false;
+    }
+  }
+}
+
+void EhSortCommands(EhCommand_t* cmds, uint16_t count)
+{
+  // Heapsort: no recursion, no extra memory, & no quadratic worst case
+  for (uint16_t i = count / 2U; i > 0; --i)
+  {
+    EhSiftDown(cmds, (uint16_t)(i - 1U), count);
+  }
+  for (uint16_t end = count; end > 1; --end)
+  {
+    const EhCommand_t swap = cmds[0];
+    cmds[0]                = cmds[end - 1U];
+    cmds[end - 1U]         = swap;
+    EhSiftDown(cmds, 0, (uint16_t)(end - 1U));
+  }
+}
+
+/** @brief Gets the commands registered with EHSH_REGISTER_COMMAND(). They
+ * are only usable once EhInit() has sorted them.
+ *
+ * @param[out] cmds Receives the registered commands, or `NULL` if there are none.
+ * @param[out] count Receives the number of commands registered.
+ * @return `false` if more commands are registered than a uint16_t can count.
+ */
+static bool EhRegistered(EhCommand_t** cmds, uint16_t* count)
+{
+  bool fits = true;
+  *cmds     = NULL;
+  *count    = 0;
+
+#ifdef EHSH_REGISTERED_START
+  if (EHSH_REGISTERED_START != NULL)
+  {
+    const size_t total = (size_t)(EHSH_REGISTERED_STOP - EHSH_REGISTERED_START);
+    fits               = total <= UINT16_MAX;
+    *cmds              = fits ? EHSH_REGISTERED_START : NULL;
+    *count             = fits ? (uint16_t)total : 0;
+  }
+#endif /* EHSH_REGISTERED_START */
+
+  return fits;
+}
+
+/** @brief Checks a table & its subcommand tables are sorted without duplicates. */
+static bool EhIsSorted(const EhCommand_t* cmds, uint16_t count)
+{
+  bool sorted = true;
+  for (uint16_t i = 0; (sorted) && (i < count); ++i)
+  {
+    sorted = (i == 0) || (EhCompareName(cmds[i - 1].Name, cmds[i].Name, EHSH_CMDLINE_SIZE) < 0);
+    if ((sorted) && (cmds[i].Children != NULL))
+    {
+      sorted = EhIsSorted(cmds[i].Children, cmds[i].ChildCount);
+    }
+  }
+  return sorted;
+}
+
+EhShell_t* EhInit(EhShell_t* self, const EhConfig_t* config)
+{
+  const EhCommand_t* cmds  = NULL;
+  uint16_t           count = 0;
+
+  if (config != NULL)
+  {
+    cmds  = config->Commands;
+    count = config->CommandCount;
+    if (cmds == NULL)
+    {
+      EhCommand_t* registered = NULL;
+      if (!EhRegistered(&registered, &count))
+      {
+        self = NULL;
+      }
+#ifdef EHSH_REGISTERED_START
+      // Sorted in place the first time; unsynchronized, hence EhInit() is not thread-safe
+      if ((self != NULL) && (!EhRegisteredSorted))
+      {
+        EhSortCommands(registered, count);
+        EhRegisteredSorted = true;
+      }
+#endif /* EHSH_REGISTERED_START */
+      // Unnamed entries (section padding, or the start marker) sort first; skip them
+      while ((count > 0) && (registered[0].Name == NULL))
+      {
+        ++registered;
+        --count;
+      }
+      cmds = registered;
+    }
+    if (!EhIsSorted(cmds, count))
+    {
+      self = NULL;
+    }
+  }
+
+  if ((self != NULL) && (config != NULL))
+  {
+    memset(self, 0, sizeof(*self));
+    self->Cmds     = cmds;
+    self->CmdCount = count;
+    self->Hash     = config->Hash;
+    self->HelpDict = config->HelpDict;
+    self->Platform  = config->Platform;
+    self->Transport = config->Transport;
+#if EHSH_CFG_STATS
+    self->Stats = config->Stats;
+#endif /* EHSH_CFG_STATS */
+    self->Eol      = config->Eol;
+    self->Tty      = config->Tty;
+    self->Cr       = config->Cr;
+    self->Lf       = config->Lf;
+    self->Prompt   = 1;
+  }
+  return self;
+}
+
+void EhDeInit(EhShell_t* self)
+{
+  (void)self;
+}
+
+static void EhOnPrompt(EhShell_t* self)
+{
+  if (self->Prompt)
+  {
+    self->Prompt = 0;
+    if ((self->Tty) && (!self->Framed))
+    {
+      EhPutStr(self, EHSH_PROMPT);
+      EhFlush(self);
+    }
+  }
+}
+
+#if EHSH_CFG_FRAMED
+/** @brief CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF).
+ * Computed bitwise, as frames are short & flash is not.
+ */
+static uint16_t EhCrc16(const char* buf, size_t length)
+{
+  uint16_t crc = 0xFFFFU;
+  for (size_t i = 0; i < length; ++i)
+  {
+    crc ^= (uint16_t)((uint8_t)buf[i] << 8);
+    for (int bit = 0; bit < 8; ++bit)
+    {
+      crc = ((crc & 0x8000U) != 0) ? (uint16_t)((crc << 1) ^ 0x1021U) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+/** @brief EhShell.FrameCapture input: a request runs without taking input. */
+static char EhCaptureGetChar(void* context)
+{
+  (void)context;
+  return (char)-1;
+}
+
+/** @brief EhShell.FrameCapture output: appends to EhShell.FrameOut. Counts
+ * one byte past the end, so an overflow can be reported.
+ */
+static void EhCapturePutChar(void* context, char chr)
+{
+  EhShell_t* self = (EhShell_t*)context;
+  if (self->FrameOutLength < (EHSH_FRAME_OUT_SIZE + 2))
+  {
+    self->FrameOut[self->FrameOutLength] = chr;
+  }
+  if (self->FrameOutLength <= (EHSH_FRAME_OUT_SIZE + 2))
+  {
+    ++self->FrameOutLength;
+  }
+}
+
+/** @brief COBS-encodes the first length bytes of EhShell.FrameOut & outputs
+ * them, followed by the 0x00 delimiter.
+ */
+static void EhPutFrame(EhShell_t* self, size_t length)
+{
+  const char* out  = &self->FrameOut[0];
+  size_t      i    = 0;
+  bool        done = false;
+
+  while (!done)
+  {
+    size_t run = 0;
+    while (((i + run) < length) && (out[i + run] != '\0') && (run < EHSH_COBS_RUN_MAX))
+    {
+      ++run;
+    }
+    EhPutChar(self, (char)(run + 1));
+    for (size_t j = 0; j < run; ++j)
+    {
+      EhPutChar(self, out[i + j]);
+    }
+    i += run;
+    if (i == length)
+    {
+      done = true;
+    }
+    else if (run < EHSH_COBS_RUN_MAX)
+    {
+      ++i;  // The zero this block's code stands for
+    }
+  }
+  EhPutChar(self, '\0');
+  EhFlush(self);
+}
+
+/** @brief Runs a request whose name & arguments are in EhShell.CmdLine,
+ * separated by '\0', capturing its output into EhShell.FrameOut.
+ */
+static EhFrameStatus_t EhOnRequest(EhShell_t* self)
+{
+  const EhTransport_t* transport = self->Transport;
+  EhFrameStatus_t      status    = EHSH_FRAME_OK;
+  bool                 fits      = true;
+
+  self->Nul      = '\0';
+  self->ArgCount = 0;
+  for (EhIndex_t i = 0; i < self->Length; ++i)
+  {
+    if (self->CmdLine[i] != '\0')
+    {
+      // Part of a token
+    }
+    else if (self->ArgCount < EHSH_MAX_ARGS)
+    {
+      self->ArgIdx[self->ArgCount] = (EhIndex_t)(i + 1);
+      ++self->ArgCount;
+    }
+    else
+    {
+      fits = false;
+    }
+  }
+
+  self->FrameCapture.GetChar = &EhCaptureGetChar;
+  self->FrameCapture.PutChar = &EhCapturePutChar;
+  self->FrameCapture.PutStr  = NULL;
+  self->FrameCapture.Flush   = NULL;
+  self->FrameCapture.Context = self;
+  self->Transport            = &self->FrameCapture;
+
+  status = fits ? EhDispatch(self, 0) : EHSH_FRAME_BAD_ARGS;
+  while (self->Running != NULL)
+  {
+    EhCall(self, self->Running);  // No prompt to return to, so yielding is moot
+  }
+
+  self->Transport = transport;
+  if (self->FrameOutLength > (EHSH_FRAME_OUT_SIZE + 2))
+  {
+    self->FrameOutLength = EHSH_FRAME_OUT_SIZE + 2;
+    status               = (status == EHSH_FRAME_OK) ? EHSH_FRAME_TRUNCATED : status;
+  }
+
+  return status;
+}
+
+/** @brief Checks & runs the request decoded into EhShell.CmdLine, then sends
+ * the response frame.
+ *
+ * @param complete Whether the frame decoded cleanly & fit in EhShell.CmdLine.
+ */
+static void EhOnFrame(EhShell_t* self, bool complete)
+{
+  const EhIndex_t length = self->Length;
+  EhFrameStatus_t status = EHSH_FRAME_BAD_FRAME;
+
+  self->FrameOut[0]    = self->CmdLine[0];  // Sequence number
+  self->FrameOutLength = 2;
+
+  // At least a sequence number, a 1 character name, & the CRC
+  if ((complete) && (length >= 4))
+  {
+    const uint16_t crc = (uint16_t)(((uint8_t)self->CmdLine[length - 2] << 8) | (uint8_t)self->CmdLine[length - 1]);
+    if (crc == EhCrc16(self->CmdLine, length - 2U))
+    {
+      memmove(&self->CmdLine[0], &self->CmdLine[1], length - 3U);
+      memset(&self->CmdLine[length - 3U], 0, 3);
+      self->Length = (EhIndex_t)(length - 3U);
+      status       = EhOnRequest(self);
+    }
+  }
+
+  self->FrameOut[1]  = (char)status;
+  const uint16_t crc = EhCrc16(self->FrameOut, self->FrameOutLength);
+  self->FrameOut[self->FrameOutLength]      = (char)(crc >> 8);
+  self->FrameOut[self->FrameOutLength + 1U] = (char)(crc & 0xFFU);
+  EhPutFrame(self, self->FrameOutLength + 2U);
+
+  memset(&self->CmdLine[0], 0, length);
+  self->Cursor = 0;
+  self->Length = 0;
+}
+
+/** @brief Decodes one byte of a COBS-framed request into EhShell.CmdLine.
+ *
+ * @return `true` if it ended a request, which has been answered.
+ */
+static bool EhOnFrameByte(EhShell_t* self, char chr)
+{
+  bool ran = false;
+
+  if (chr == '\0')
+  {
+    // Back-to-back delimiters are ignored, so a host may send one to resync
+    if (self->FrameBlock != 0)
+    {
+      EhOnFrame(self, (self->FrameCode == 0) && (!self->FrameOverflow));
+      ran = true;
+    }
+    self->FrameCode     = 0;
+    self->FrameBlock    = 0;
+    self->FrameOverflow = 0;
+  }
+  else
+  {
+    const bool code = self->FrameCode == 0;
+    // A new block means the last one ended in a zero, unless it was full
+    const bool zero = code && (self->FrameBlock != 0) && (self->FrameBlock != (EHSH_COBS_RUN_MAX + 1));
+    if (zero || !code)
+    {
+      if (self->Length < EHSH_CMDLINE_SIZE)
+      {
+        self->CmdLine[self->Length] = zero ? '\0' : chr;
+        ++self->Length;
+      }
+      else
+      {
+        self->FrameOverflow = 1;
+      }
+    }
+    if (code)
+    {
+      self->FrameBlock = (uint8_t)chr;
+      self->FrameCode  = (uint8_t)(self->FrameBlock - 1U);
+    }
+    else
+    {
+      --self->FrameCode;
+    }
+  }
+
+  return ran;
+}
+#endif /* EHSH_CFG_FRAMED */
+
+static bool EhOnInput(EhShell_t* self, char chr)
+{
+  bool ran = false;
+
+  if ((uint8_t)chr < 0x20U)
+  {
+    // As on a terminal, a control byte cuts an escape sequence short & acts as
+    // usual, so e.g. EOT still ends EhExec() after a truncated ESC [
+    self->Escape = EHSH_ESCAPE_NONE;
+  }
+
+#if EHSH_CFG_FRAMED
+  if (self->Framed)
+  {
+    ran = (chr != (char)-1) && EhOnFrameByte(self, chr);
+  }
+  else
+#endif /* EHSH_CFG_FRAMED */
+  if ((self->Escape != EHSH_ESCAPE_NONE) && (chr != (char)-1))
+  {
+    EhOnEscape(self, chr);
+  }
+  else if (chr == '\n')
+  {
+    if (self->Eol == EHSH_EOL_LF)
+    {
+      EhOnNewline(self);
+      ran = true;
+    }
+  }
+  else if (chr == '\r')
+  {
+    if (self->Eol == EHSH_EOL_CR)
+    {
+      EhOnNewline(self);
+      ran = true;
+    }
+  }
+  else if (chr == EHSH_ASCII_EOT)
+  {
+    self->Stop = 1;
+  }
+  else if (chr == EHSH_ASCII_ESC)
+  {
+    self->Escape = EHSH_ESCAPE_ESC;
+  }
+  else if ((chr == EHSH_ASCII_DEL) || (chr == EHSH_ASCII_BS))
+  {
+    EhOnBackspace(self);
+  }
+  else if (chr == '\t')
+  {
+    if (self->Tty)
+    {
+      EhOnTab(self);
+    }
+  }
+  else if (chr == (char)-1)
+  {
+    // Nothing pending
+  }
+  else if ((unsigned char)chr < ' ')
+  {
+    EhOnControl(self, chr);
+  }
+  else
+  {
+    EhOnChar(self, chr);
+  }
+
+  return ran;
+}
+
+void EhExec(EhShell_t* self)
+{
+  self->Prompt = 1;
+
+  do
+  {
+    (void)EhPoll(self);
+    EhFinish(self);
+  } while (!self->Stop);
+}
+
+/** @brief Calls the running command once more. Once it's done, the rest of
+ * its line's segments run, unless it was interrupted.
+ *
+ * @return `false` if one of those segments failed.
+ */
+static bool EhStep(EhShell_t* self)
+{
+  bool ok = true;
+  EhCall(self, self->Running);
+  if ((self->Running == NULL) && (self->SegmentNext != 0) && (!self->Interrupted))
+  {
+    ok = EhRunSegments(self);
+  }
+  return ok;
+}
+
+/** @brief Steps the running command, wrapping up its line if it's done. */
+static void EhResume(EhShell_t* self)
+{
+  (void)EhStep(self);
+  if (self->Running == NULL)
+  {
+    EhFinishLine(self);
+  }
+}
+
+void EhFinish(EhShell_t* self)
+{
+  while (self->Running != NULL)
+  {
+    EhResume(self);
+  }
+}
+
+/** @brief Takes one byte of input received while a command was running:
+ * Ctrl-C interrupts it, discarding what was typed ahead as a terminal does,
+ * and the rest is buffered.
+ *
+ * @return `false` if there was no room to buffer chr.
+ */
+static bool EhTypeAhead(EhShell_t* self, char chr)
+{
+  bool taken = true;
+  if (chr == EHSH_ASCII_ETX)
+  {
+    self->Interrupted = 1;
+#if EHSH_TYPEAHEAD_SIZE > 0
+    self->TypeAheadHead   = 0;
+    self->TypeAheadLength = 0;
+#endif /* EHSH_TYPEAHEAD_SIZE > 0 */
+  }
+#if EHSH_TYPEAHEAD_SIZE > 0
+  else if (self->TypeAheadLength < EHSH_TYPEAHEAD_SIZE)
+  {
+    if ((self->TypeAheadHead + self->TypeAheadLength) == EHSH_TYPEAHEAD_SIZE)
+    {
+      memmove(&self->TypeAhead[0], &self->TypeAhead[self->TypeAheadHead], self->TypeAheadLength);
+      self->TypeAheadHead = 0;
+    }
+    self->TypeAhead[self->TypeAheadHead + self->TypeAheadLength] = chr;
+    ++self->TypeAheadLength;
+  }
+#endif /* EHSH_TYPEAHEAD_SIZE > 0 */
+  else
+  {
+    taken = false;
+  }
+  return taken;
+}
+
+/** @brief Buffers input fed while a command is running, up to the first byte
+ * that doesn't fit. Past that, only a Ctrl-C is looked for; as it discards the
+ * buffer anyway, the bytes before it are dropped.
+ *
+ * @return Number of bytes of buf taken.
+ */
+static size_t EhTypeAheadFeed(EhShell_t* self, const char* buf, size_t length)
+{
+  size_t i     = 0;
+  bool   taken = true;
+
+  while ((taken) && (i < length))
+  {
+    taken = EhTypeAhead(self, buf[i]);
+    if (taken)
+    {
+      ++i;
+    }
+    else
+    {
+      const char* etx = (const char*)memchr(&buf[i], EHSH_ASCII_ETX, length - i);
+      if (etx != NULL)
+      {
+        i     = (size_t)(etx - buf);
+        taken = true;
+      }
+    }
+  }
+
+  return i;
+}
+
+/** @brief Next byte of input: buffered type-ahead first, then EhGetChar(). */
+static char EhNextChar(EhShell_t* self)
+{
+  char chr = (char)-1;
+#if EHSH_TYPEAHEAD_SIZE > 0
+  if (self->TypeAheadLength > 0)
+  {
+    chr = self->TypeAhead[self->TypeAheadHead];
+    --self->TypeAheadLength;
+    self->TypeAheadHead = (self->TypeAheadLength > 0) ? (uint16_t)(self->TypeAheadHead + 1) : 0;
+  }
+  else
+#endif /* EHSH_TYPEAHEAD_SIZE > 0 */
+  {
+    chr = EhGetChar(self);
+  }
+  return chr;
+}
+
+EhStatus_t EhPoll(EhShell_t* self)
+{
+  EhStatus_t status  = EHSH_STATUS_IDLE;
+  bool       pending = true;
+
+  EhOnPrompt(self);
+
+  if (self->Running != NULL)
+  {
+    // Buffer what's been typed meanwhile. Anything past a full buffer is read
+    // & dropped rather than left unread, so a Ctrl-C behind it gets through.
+    while (pending)
+    {
+      const char chr = EhGetChar(self);
+      pending        = chr != (char)-1;
+      if (pending)
+      {
+        (void)EhTypeAhead(self, chr);
+      }
+    }
+    EhResume(self);
+    status = EHSH_STATUS_RAN;
+  }
+
+  while ((pending) && (status == EHSH_STATUS_IDLE) && (!self->Stop))
+  {
+    char chr = EhNextChar(self);
+    if (chr == (char)-1)
+    {
+      pending = false;
+    }
+    else if (EhOnInput(self, chr))
+    {
+      status = EHSH_STATUS_RAN;
+    }
+  }
+
+  if (self->Running != NULL)
+  {
+    status = EHSH_STATUS_BUSY;
+  }
+
+  if (self->Stop)
+  {
+    status = EHSH_STATUS_STOPPED;
+  }
+
+  return status;
+}
+
+size_t EhFeed(EhShell_t* self, const char* buf, size_t length)
+{
+  size_t i = 0;
+
+  EhOnPrompt(self);
+
+  if (self->Running != NULL)
+  {
+    i = EhTypeAheadFeed(self, buf, length);
+    EhResume(self);
+  }
+
+#if EHSH_TYPEAHEAD_SIZE > 0
+  // Once nothing is running, what was typed meanwhile goes first
+  while ((self->TypeAheadLength > 0) && (self->Running == NULL) && (!self->Stop))
+  {
+    (void)EhOnInput(self, EhNextChar(self));
+  }
+#endif /* EHSH_TYPEAHEAD_SIZE > 0 */
+
+  while ((i < length) && (self->Running == NULL) && (!self->Stop))
+  {
+    // Plain characters within an escape sequence are part of it, and those
+    // typed mid-line are inserted one at a time
+    const bool   bulk = (self->Escape == EHSH_ESCAPE_NONE) && (self->Cursor == self->Length) && (!self->Framed);
+    const size_t run  = bulk ? EhScanPlain(&buf[i], length - i) : 0;
+    if (run > 0)
+    {
+      EhOnChars(self, &buf[i], run);
+      i += run;
+    }
+    else
+    {
+      (void)EhOnInput(self, buf[i]);
+      ++i;
+    }
+  }
+
+  // A command yielded part way through buf, so the rest waits for it
+  if (self->Running != NULL)
+  {
+    i += EhTypeAheadFeed(self, &buf[i], length - i);
+  }
+  EhFlush(self);
+
+  return i;
+}
+
+/** @brief Runs one script line (without its line ending) as a command line.
+ * @return `false` if the line is too long, names no command, or has invalid arguments.
+ */
+static bool EhRunLine(EhShell_t* self, const char* line, size_t length)
+{
+  bool ran = false;
+
+  while ((length > 0) && ((line[0] == ' ') || (line[0] == '\t')))
+  {
+    ++line;
+    --length;
+  }
+
+  if ((length == 0) || (line[0] == '#'))
+  {
+    ran = true;  // Blank & comment lines are skipped without dispatching
+  }
+  else if (length <= EHSH_CMDLINE_SIZE)
+  {
+    memcpy(&self->CmdLine[0], line, length);
+    self->Length = (EhIndex_t)length;
+    ran          = EhHandleCmdLine(self);
+    while (self->Running != NULL)
+    {
+      ran = EhStep(self) && ran;
+    }
+    memset(&self->CmdLine[0], 0, self->Length);
+    self->Length      = 0;
+    self->Segment     = 0;
+    self->SegmentNext = 0;
+  }
+
+  return ran;
+}
+
+size_t EhRunScript(EhShell_t* self, const char* script, size_t length, size_t* lines)
+{
+  const char* end    = script + length;
+  size_t      line   = 0;
+  size_t      failed = 0;
+
+  // Discard any partially typed line. Lines are dispatched without passing
+  // through echo or the prompt, so Tty is left as is & `stty` takes effect.
+  memset(&self->CmdLine[0], 0, self->Length);
+  self->Cursor = 0;
+  self->Length = 0;
+
+  while ((script < end) && (failed == 0) && (!self->Stop))
+  {
+    const char* eol  = (const char*)memchr(script, '\n', (size_t)(end - script));
+    const char* next = (eol != NULL) ? (eol + 1) : end;
+    eol              = (eol != NULL) ? eol : end;
+    if ((eol > script) && (eol[-1] == '\r'))
+    {
+      --eol;
+    }
+
+    ++line;
+    if (!EhRunLine(self, script, (size_t)(eol - script)))
+    {
+      failed = line;
+    }
+    script = next;
+  }
+
+  EhComplete(self);
+  EhFlush(self);
+  if (lines != NULL)
+  {
+    *lines = line;
+  }
+
+  return failed;
+}
+
+void EhPutNewline(EhShell_t* self)
+{
+  if (self->Cr)
+  {
+    EhPutChar(self, '\r');
+  }
+  if (self->Lf)
+  {
+    EhPutChar(self, '\n');
+  }
+}
+
+/** @brief FNV-1a hash of a command name.
+ * @note Must match `_ehsh_hash_name()` in tools/ehsh-commands.cmake.
+ */
+static uint32_t EhHashName(const char* name, size_t* length)
+{
+  uint32_t hash = 2166136261U;
+  size_t   i    = 0;
+
+  for (; (i < EHSH_CMDLINE_SIZE) && (name[i] != '\0'); ++i)
+  {
+    hash ^= (uint8_t)name[i];
+    hash *= 16777619U;
+  }
+
+  *length = i;
+  return hash;
+}
+
+/** @brief Integer finalizer that spreads a displaced hash across slots.
+ * @note Must match `_ehsh_hash_slot()` in tools/ehsh-commands.cmake.
+ */
+static uint32_t EhMix(uint32_t hash)
+{
+  hash = ((hash >> 16) ^ hash) * 0x45D9F3BU;
+  return (hash >> 16) ^ hash;
+}
+
+static const EhCommand_t* EhHashLookup(const EhShell_t* self, const char* name)
+{
+  const EhCommand_t* cmd    = NULL;
+  size_t             length = 0;
+  const uint32_t     hash   = EhHashName(name, &length);
+  const uint16_t     bucket = hash % self->Hash->BucketCount;
+  const uint32_t     slot   = EhMix(hash ^ self->Hash->Displacements[bucket]) % self->CmdCount;
+  const EhCommand_t* match  = &self->Cmds[self->Hash->Slots[slot]];
+
+  if ((self->Hash->Lengths[slot] == length) && (memcmp(match->Name, name, length) == 0))
+  {
+    cmd = match;
+  }
+
+  return cmd;
+}
+
+const EhCommand_t* EhFindCommand(const EhShell_t* self, const char* name)
+{
+  const EhCommand_t* cmd = NULL;
+
+  if ((self->Hash != NULL) && (self->CmdCount > 0))
+  {
+    cmd = EhHashLookup(self, name);
+  }
+  else
+  {
+    const uint16_t index = EhBisect(self->Cmds, self->CmdCount, name, EHSH_CMDLINE_SIZE, 0);
+    if ((index < self->CmdCount) && (EhCompareName(self->Cmds[index].Name, name, EHSH_CMDLINE_SIZE) == 0))
+    {
+      cmd = &self->Cmds[index];
+    }
+  }
+
+  return cmd;
+}
+
+uint16_t EhFindCommands(const EhShell_t* self, const char* prefix, size_t length, uint16_t* first)
+{
+  *first = EhBisect(self->Cmds, self->CmdCount, prefix, length, 0);
+  return EhBisect(self->Cmds, self->CmdCount, prefix, length, 1) - *first;
+}
+
+const EhCommand_t* EhFindSubcommand(const EhCommand_t* group, const char* name)
+{
+  const EhCommand_t* cmd   = NULL;
+  const uint16_t     index = EhBisect(group->Children, group->ChildCount, name, EHSH_CMDLINE_SIZE, 0);
+
+  if ((index < group->ChildCount) && (EhCompareName(group->Children[index].Name, name, EHSH_CMDLINE_SIZE) == 0))
+  {
+    cmd = &group->Children[index];
+  }
+
+  return cmd;
+}
+
+uint16_t EhFindSubcommands(const EhCommand_t* group, const char* prefix, size_t length, uint16_t* first)
+{
+  *first = EhBisect(group->Children, group->ChildCount, prefix, length, 0);
+  return EhBisect(group->Children, group->ChildCount, prefix, length, 1) - *first;
+}
+
+static const EhCommand_t* EhResolve(const EhShell_t* self, EhIndex_t start, EhIndex_t* depth, const EhCommand_t** root)
+{
+  const EhCommand_t* cmd  = EhFindCommand(self, &self->CmdLine[start]);
+  const EhCommand_t* next = cmd;
+
+  *depth = 0;
+  if (root != NULL)
+  {
+    *root = cmd;
+  }
+  while ((next != NULL) && (next->Children != NULL) && (*depth < self->ArgCount))
+  {
+    next = EhFindSubcommand(next, &self->CmdLine[self->ArgIdx[*depth]]);
+    if (next != NULL)
+    {
+      cmd = next;
+      ++*depth;
+    }
+  }
+
+  return cmd;
+}
+
+#if EHSH_CFG_STATS
+/** @brief Accumulates the duration of one callback into its command's stats. */
+static void EhRecordStats(EhStats_t* stats, uint32_t ticks)
+{
+  uint8_t bucket = 0;
+  for (uint32_t rest = ticks; (rest != 0) && (bucket < (EHSH_STATS_BUCKETS - 1)); rest >>= 1)
+  {
+    ++bucket;
+  }
+
+  if ((stats->Calls == 0) || (ticks < stats->Min))
+  {
+    stats->Min = ticks;
+  }
+  if (ticks > stats->Max)
+  {
+    stats->Max = ticks;
+  }
+  ++stats->Calls;
+  stats->Total += ticks;
+  ++stats->Histogram[bucket];
+}
+#endif /* EHSH_CFG_STATS */
+
+/** @brief Value of a hexadecimal digit, or 16 if chr is not one. */
+static uint8_t EhHexDigit(char chr)
+{
+  uint8_t digit = 16;
+  if ((chr >= '0') && (chr <= '9'))
+  {
+    digit = (uint8_t)(chr - '0');
+  }
+  else if (((chr | 0x20) >= 'a') && ((chr | 0x20) <= 'f'))
+  {
+    digit = (uint8_t)((chr | 0x20) - 'a' + 10);
+  }
+  return digit;
+}
+
+/** @brief Parses 1 to 8 hex digits, with an optional `0x` prefix. */
+static bool EhParseHex(const char* str, uint32_t* value)
+{
+  if ((str[0] == '0') && ((str[1] | 0x20) == 'x'))
+  {
+    str += 2;
+  }
+
+  uint32_t result = 0;
+  size_t   count  = 0;
+  while ((count <= 8) && (EhHexDigit(str[count]) < 16))
+  {
+    result = (result << 4) | EhHexDigit(str[count]);
+    ++count;
+  }
+
+  const bool valid = (count > 0) && (count <= 8) && (str[count] == '\0');
+  if (valid)
+  {
+    *value = result;
+  }
+  return valid;
+}
+
+/** @brief Parses decimal digits up to limit; *end is set past the last digit. */
+static bool EhParseDecimal(const char* str, uint32_t limit, uint32_t* value, const char** end)
+{
+  uint32_t result = 0;
+  bool     valid  = (str[0] >= '0') && (str[0] <= '9');
+  for (; (valid) && (*str >= '0') && (*str <= '9'); ++str)
+  {
+    const uint32_t digit = (uint32_t)(*str - '0');
+    valid                = (result <= ((limit - digit) / 10));
+    result               = (result * 10) + digit;
+  }
+  *value = result;
+  *end   = str;
+  return valid;
+}
+
+static bool EhParseU32(const char* str, uint32_t* value)
+{
+  bool valid = false;
+  if ((str[0] == '0') && ((str[1] | 0x20) == 'x'))
+  {
+    valid = EhParseHex(str, value);
+  }
+  else
+  {
+    uint32_t    result = 0;
+    const char* end    = str;
+    valid              = EhParseDecimal(str, UINT32_MAX, &result, &end) && (*end == '\0');
+    if (valid)
+    {
+      *value = result;
+    }
+  }
+  return valid;
+}
+
+/** @brief Parses [-+]digits[.digits] scaled by 10^decimals; I32 is fixed with 0 decimals. */
+static bool EhParseFixed(const char* str, uint8_t decimals, int32_t* value)
+{
+  const bool     negative = (str[0] == '-');
+  const uint32_t limit    = negative ? ((uint32_t)INT32_MAX + 1U) : (uint32_t)INT32_MAX;
+  str += ((str[0] == '-') || (str[0] == '+')) ? 1 : 0;
+
+  uint32_t scale = 1;
+  for (uint8_t i = 0; i < decimals; ++i)
+  {
+    scale *= 10;
+  }
+
+  uint32_t    whole = 0;
+  uint32_t    frac  = 0;
+  const char* end   = str;
+  bool        valid = (decimals <= 9) && EhParseDecimal(str, limit / scale, &whole, &end);
+
+  if ((valid) && (*end == '.') && (decimals > 0))
+  {
+    const char* digits = end + 1;
+    valid              = EhParseDecimal(digits, UINT32_MAX, &frac, &end) && ((size_t)(end - digits) <= decimals);
+    for (size_t i = (size_t)(end - digits); (valid) && (i < decimals); ++i)
+    {
+      frac *= 10;
+    }
+  }
+
+  const uint32_t magnitude = (whole * scale) + frac;
+  valid                    = (valid) && (*end == '\0') && (magnitude <= limit);
+  if ((valid) && (negative) && (magnitude > 0))
+  {
+    // INT32_MIN's magnitude does not fit in an int32_t
+    *value = -(int32_t)(magnitude - 1) - 1;
+  }
+  else if (valid)
+  {
+    *value = (int32_t)magnitude;
+  }
+  return valid;
+}
+
+/** @brief Case-insensitive comparison of str against a lowercase word. */
+static bool EhIsWord(const char* str, const char* word)
+{
+  while ((*word != '\0') && ((*str | 0x20) == *word))
+  {
+    ++str;
+    ++word;
+  }
+  return (*str == '\0') && (*word == '\0');
+}
+
+static bool EhParseBool(const char* str, bool* value)
+{
+  const bool yes   = EhIsWord(str, "1") || EhIsWord(str, "on") || EhIsWord(str, "true") || EhIsWord(str, "yes");
+  const bool no    = EhIsWord(str, "0") || EhIsWord(str, "off") || EhIsWord(str, "false") || EhIsWord(str, "no");
+  const bool valid = yes || no;
+  if (valid)
+  {
+    *value = yes;
+  }
+  return valid;
+}
+
+bool EhArgU32(EhShell_t* self, EhIndex_t index, uint32_t* value)
+{
+  const char* arg = EhArgAt(self, index);
+  return (arg != NULL) && EhParseU32(arg, value);
+}
+
+bool EhArgI32(EhShell_t* self, EhIndex_t index, int32_t* value)
+{
+  const char* arg = EhArgAt(self, index);
+  return (arg != NULL) && EhParseFixed(arg, 0, value);
+}
+
+bool EhArgHex(EhShell_t* self, EhIndex_t index, uint32_t* value)
+{
+  const char* arg = EhArgAt(self, index);
+  return (arg != NULL) && EhParseHex(arg, value);
+}
+
+bool EhArgBool(EhShell_t* self, EhIndex_t index, bool* value)
+{
+  const char* arg = EhArgAt(self, index);
+  return (arg != NULL) && EhParseBool(arg, value);
+}
+
+bool EhArgFixed(EhShell_t* self, EhIndex_t index, uint8_t decimals, int32_t* value)
+{
+  const char* arg = EhArgAt(self, index);
+  return (arg != NULL) && EhParseFixed(arg, decimals, value);
+}
+
+#if EHSH_CFG_ARG_SCHEMA
+/** @brief Parses one argument per its spec, including bounds. */
+static bool EhParseArg(const EhArgSpec_t* spec, const char* arg, EhArgValue_t* value)
+{
+  bool    valid  = false;
+  int64_t number = 0;
+  switch (spec->Type)
+  {
+    case EHSH_ARG_U32:
+      valid  = EhParseU32(arg, &value->U32);
+      number = valid ? value->U32 : 0;
+      break;
+    case EHSH_ARG_HEX:
+      valid  = EhParseHex(arg, &value->U32);
+      number = valid ? value->U32 : 0;
+      break;
+    case EHSH_ARG_I32:
+      valid  = EhParseFixed(arg, 0, &value->I32);
+      number = valid ? value->I32 : 0;
+      break;
+    case EHSH_ARG_FIXED:
+      valid  = EhParseFixed(arg, spec->Decimals, &value->I32);
+      number = valid ? value->I32 : 0;
+      break;
+    case EHSH_ARG_BOOL:
+      valid = EhParseBool(arg, &value->Bool);
+      break;
+    default:
+      valid = true;
+      break;
+  }
+
+  if ((valid) && (spec->Min != spec->Max))
+  {
+    valid = (number >= spec->Min) && (number <= spec->Max);
+  }
+  return valid;
+}
+
+/** @brief Prints why a command's arguments were rejected, and how to call it. */
+static void EhPutUsage(EhShell_t* self, const EhCommand_t* cmd, const char* problem)
+{
+  EhPutStr(self, problem);
+  EhPutStr(self, "; usage: ");
+  EhPutStr(self, cmd->Name);
+  for (const EhArgSpec_t* spec = cmd->Args; spec->Name != NULL; ++spec)
+  {
+    EhPutStr(self, spec->Optional ? " [" : " <");
+    EhPutStr(self, spec->Name);
+    EhPutChar(self, spec->Optional ? ']' : '>');
+  }
+  EhPutNewline(self);
+}
+
+/** @brief Parses the arguments into EhShell.ArgValues per the command's
+ * schema, printing a usage message if any are missing, malformed, out of
+ * bounds, or unexpected.
+ */
+static bool EhValidateArgs(EhShell_t* self, const EhCommand_t* cmd)
+{
+  const EhArgSpec_t* spec  = cmd->Args;
+  bool               valid = true;
+  EhIndex_t          i     = 0;
+
+  for (; (valid) && (spec[i].Name != NULL); ++i)
+  {
+    const char* arg = EhArgAt(self, i);
+    if (arg == NULL)
+    {
+      valid = spec[i].Optional;
+    }
+    else
+    {
+      valid = EhParseArg(&spec[i], arg, &self->ArgValues[i]);
+    }
+  }
+
+  if (!valid)
+  {
+    EhPutStr(self, "Invalid ");
+    EhPutUsage(self, cmd, spec[i - 1].Name);
+  }
+  else if (self->ArgCount > i)
+  {
+    EhPutUsage(self, cmd, "Too many arguments");
+    valid = false;
+  }
+  return valid;
+}
+#endif /* EHSH_CFG_ARG_SCHEMA */
+
+/** @brief Calls a command once, timing it when stats are kept. A yielding
+ * command is timed per call, as each call is how long the shell is blocked.
+ * The command becomes EhShell.Running if it calls EhYield(), unless interrupted.
+ */
+static void EhCall(EhShell_t* self, const EhCommand_t* cmd)
+{
+  self->Yield = 0;
+#if EHSH_CFG_STATS
+  if (self->Stats != NULL)
+  {
+    EhStats_t*     stats = &self->Stats[self->StatsIndex];
+    const uint32_t start = EhTicks(self);
+    cmd->Callback(self);
+    EhRecordStats(stats, EhTicks(self) - start);
+  }
+  else
+  {
+    cmd->Callback(self);
+  }
+#else
+  cmd->Callback(self);
+#endif /* EHSH_CFG_STATS */
+  self->Running = ((self->Yield) && (!self->Interrupted) && (!self->Stop)) ? cmd : NULL;
+}
+
+static EhFrameStatus_t EhDispatch(EhShell_t* self, EhIndex_t start)
+{
+  const EhCommand_t* root   = NULL;
+  EhIndex_t          depth  = 0;
+  const EhCommand_t* cmd    = EhResolve(self, start, &depth, &root);
+  EhFrameStatus_t    status = EHSH_FRAME_OK;
+
+#if EHSH_CFG_STATS
+  self->StatsIndex = (root != NULL) ? (uint16_t)(root - self->Cmds) : 0;
+#else
+  (void)root;
+#endif /* EHSH_CFG_STATS */
+
+  if (cmd == NULL)
+  {
+    status = EHSH_FRAME_NO_COMMAND;
+  }
+  else if ((cmd->Callback == NULL) && (cmd->Children != NULL) && (depth < self->ArgCount))
+  {
+    status = EHSH_FRAME_NO_COMMAND;  // Not one of the group's subcommands
+  }
+  else if ((cmd->Callback == NULL) && (cmd->Children != NULL))
+  {
+    // A group on its own lists what it holds
+    for (uint16_t i = 0; i < cmd->ChildCount; ++i)
+    {
+      EhPutStr(self, cmd->Children[i].Name);
+      EhPutStr(self, ": ");
+      EhPutHelp(self, cmd->Children[i].Help);
+      EhPutNewline(self);
+    }
+  }
+  else
+  {
+    // Arguments naming subcommands aren't the subcommand's arguments
+    self->ArgCount = (EhIndex_t)(self->ArgCount - depth);
+    memmove(&self->ArgIdx[0], &self->ArgIdx[depth], self->ArgCount * sizeof(self->ArgIdx[0]));
+
+    if (cmd->Callback == NULL)
+    {
+      // Nothing to call
+    }
+#if EHSH_CFG_ARG_SCHEMA
+    else if ((cmd->Args != NULL) && (!EhValidateArgs(self, cmd)))
+    {
+      status = EHSH_FRAME_BAD_ARGS;
+    }
+#endif /* EHSH_CFG_ARG_SCHEMA */
+    else
+    {
+      self->State = 0;
+      EhCall(self, cmd);
+    }
+  }
+
+  return status;
+}
+
+static bool EhHandleCmdLine(EhShell_t* self)
+{
+  self->Segment     = 0;
+  self->SegmentNext = 0;
+  return EhRunSegments(self);
+}
+
+/** @brief Ends the segment starting at start at the next ';' outside double
+ * quotes, dropping any spaces before the ';'.
+ *
+ * @return Offset of the following segment, or 0 if this is the last.
+ */
+static EhIndex_t EhSplitSegment(EhShell_t* self, EhIndex_t start)
+{
+  EhIndex_t next   = 0;
+  bool      quoted = false;
+
+  for (EhIndex_t i = start; (i < self->Length) && (next == 0); ++i)
+  {
+    if (self->CmdLine[i] == '"')
+    {
+      quoted = !quoted;
+    }
+    else if ((self->CmdLine[i] == ';') && (!quoted))
+    {
+      EhIndex_t end      = i;
+      self->CmdLine[end] = '\0';
+      while ((end > start) && (self->CmdLine[end - 1U] == ' '))
+      {
+        --end;
+        self->CmdLine[end] = '\0';
+      }
+      next = (EhIndex_t)(i + 1);
+    }
+  }
+
+  return next;
+}
+
+static bool EhRunSegments(EhShell_t* self)
+{
+  bool ok   = true;
+  bool more = true;
+
+  while (more)
+  {
+    EhIndex_t start = self->SegmentNext;
+    while ((self->Segment > 0) && (self->CmdLine[start] == ' '))
+    {
+      ++start;  // Spaces after a ';'
+    }
+    self->SegmentNext = EhSplitSegment(self, start);
+    ++self->Segment;
+
+    const bool      batch  = (self->Segment > 1) || (self->SegmentNext != 0);
+    EhFrameStatus_t status = EHSH_FRAME_OK;
+    if ((batch) && (self->CmdLine[start] == '\0'))
+    {
+      // Empty segments, e.g. after a trailing ';', are skipped
+    }
+    else
+    {
+      EhTokenize(self, start);
+      status = EhDispatch(self, start);
+    }
+
+    if (status == EHSH_FRAME_NO_COMMAND)
+    {
+      EhPutNoSuchCommand(self, start);
+    }
+    ok = ok && (status == EHSH_FRAME_OK);
+    if ((status != EHSH_FRAME_OK) && (batch))
+    {
+      // Say which segment failed, as the rest of the line is skipped
+      EhPutStr(self, "Stopped at segment ");
+      EhPutDecimal(self, self->Segment);
+      EhPutNewline(self);
+      self->SegmentNext = 0;
     }
+    more = (self->SegmentNext != 0) && (self->Running == NULL) && (!self->Stop);
   }
 
-  return found;
+  return ok;
 }
 
 // TODO: Multiple spaces
 // TODO: Comment
 // TODO: Empty command just prints a newline
 // TODO: Password mode
-// TODO: History? (shell hook?)
-// TODO: RunOne (so ehsh doesn't need its own thread)
-static void EhTokenize(EhShell_t* self)
+static void EhTokenize(EhShell_t* self, EhIndex_t start)
 {
   self->Nul      = '\0';
   self->ArgCount = 0;
 
-  char* delim = &self->CmdLine[0];
+  char* delim = &self->CmdLine[start];
   while ((delim != NULL) && (self->ArgCount < EHSH_MAX_ARGS))
   {
     delim = strchr(delim, ' ');
@@ -246,7 +2474,7 @@ static void EhTokenize(EhShell_t* self)
     {
       size_t index                 = delim - &self->CmdLine[0];
       self->CmdLine[index]         = '\0';
-      self->ArgIdx[self->ArgCount] = index + 1;
+      self->ArgIdx[self->ArgCount] = (EhIndex_t)(index + 1);
       ++self->ArgCount;
       ++delim;
     }
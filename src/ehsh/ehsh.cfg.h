@@ -23,15 +23,33 @@
 // $Macros
 ////////////////////////////////////////////////////////////////////////////////
 #ifndef EHSH_CMDLINE_SIZE
-/** Number of characters in the command line, excluding null terminator. */
+/** Number of characters in the command line, excluding null terminator.
+ * Up to 255 by default; see EHSH_CFG_INDEX_WIDTH for longer lines. */
 #define EHSH_CMDLINE_SIZE 16
 #endif /* EHSH_CMDLINE_SIZE */
 
+#ifndef EHSH_CFG_INDEX_WIDTH
+/** Width in bits (8, 16, or 32) of the integers indexing the command line:
+ * EhShell.Cursor, EhShell.ArgIdx, and EhShell.ArgCount. EHSH_CMDLINE_SIZE &
+ * EHSH_MAX_ARGS are limited to what this width can index, which is checked at
+ * compile time.
+ *
+ * The default of 8 keeps the shell small for microcontrollers (lines up to
+ * 255 characters, up to 15 arguments). Use 16 or 32 for long lines, e.g.
+ * configuration blobs:
+ *
+ * @code{.sh}
+ * cc -DEHSH_CFG_INDEX_WIDTH=16 -DEHSH_CMDLINE_SIZE=8192 -DEHSH_MAX_ARGS=64 ...
+ * @endcode
+ */
+#define EHSH_CFG_INDEX_WIDTH 8
+#endif /* EHSH_CFG_INDEX_WIDTH */
+
 #ifndef EHSH_MAX_ARGS
 /** Maximum number of arguments that ehsh can tokenize.
  *
- * @note ehsh currently only supports a maximum of 15 arguments. This is checked
- * with a C11 static_assert, if available.
+ * @note With the default 8-bit EHSH_CFG_INDEX_WIDTH, ehsh supports a maximum
+ * of 15 arguments. This is checked at compile time.
  *
  * Arguments are space-delimited:
  *
@@ -56,7 +74,7 @@
  * d e f
  * @endcode
  */
-#define EHSH_MAX_ARGS 4  // Up to 15
+#define EHSH_MAX_ARGS 4  // Up to 15, unless EHSH_CFG_INDEX_WIDTH > 8
 #endif /* EHSH_MAX_ARGS */
 
 #ifndef EHSH_PROMPT
@@ -80,6 +98,134 @@
 #define EHSH_PROMPT "> "
 #endif /* EHSH_PROMPT */
 
+#ifndef EHSH_HISTORY_SIZE
+/** Bytes of RAM per shell for command history, recalled in tty mode with the
+ * up & down arrow keys. Entries are packed by their actual length (plus
+ * 2 * sizeof(EhIndex_t) bytes each), and the oldest are evicted to make room,
+ * so e.g. 128 bytes holds over 20 short commands. Up to 65535; 0 (the
+ * default) compiles history out.
+ *
+ * @code{.sh}
+ * > echo hi
+ * hi
+ * > <UP>
+ * > echo hi
+ * @endcode
+ */
+#define EHSH_HISTORY_SIZE 0
+#endif /* EHSH_HISTORY_SIZE */
+
+#ifndef EHSH_TYPEAHEAD_SIZE
+/** Bytes of input buffered per shell while a command that called EhYield()
+ * is running. They are handled once it finishes, as if typed afterwards.
+ * Ctrl-C is not buffered; it interrupts the command instead, discarding what
+ * was. Once full, EhPoll() drops further input (still watching for Ctrl-C),
+ * while EhFeed() leaves it to the caller. Up to 65535; 0 (the default)
+ * compiles the buffer out, so only Ctrl-C is taken while a command runs.
+ */
+#define EHSH_TYPEAHEAD_SIZE 0
+#endif /* EHSH_TYPEAHEAD_SIZE */
+
+#ifndef EHSH_CFG_ARG_SCHEMA
+/** Set to 1 to validate each command's arguments against its EhCommand.Args
+ * schema before calling it, parsing them into EhShell.ArgValues (which costs
+ * EHSH_MAX_ARGS * 4 bytes per shell). Bad input prints a usage message
+ * instead. When 0, schemas are ignored; commands can still parse their own
+ * arguments with EhArgU32() & co.
+ *
+ * @code{.sh}
+ * > pwm 4 50
+ * Invalid channel; usage: pwm <channel> <duty> [invert]
+ * @endcode
+ */
+#define EHSH_CFG_ARG_SCHEMA 0
+#endif /* EHSH_CFG_ARG_SCHEMA */
+
+#ifndef EHSH_TAB_LIST_MAX
+/** Maximum number of matches tab completion lists one per line. Beyond this,
+ * a single count line is printed instead, which saves time on slow links.
+ *
+ * @code{.sh}
+ * # Assuming EHSH_TAB_LIST_MAX 2:
+ * > e<TAB>
+ * echo
+ * exit
+ * > e
+ * # But with more matches:
+ * > <TAB>
+ * 5 matches
+ * >
+ * @endcode
+ */
+#define EHSH_TAB_LIST_MAX 8
+#endif /* EHSH_TAB_LIST_MAX */
+
+#ifndef EHSH_CFG_STATS
+/** Set to 1 to time every command callback through the user-defined EhTicks()
+ * hook, keeping per-command counts, min/max/total ticks, and a latency
+ * histogram in the caller-provided EhConfig.Stats array. The `stats` command
+ * (EHSH_COMMAND_STATS) prints & resets them. When 0, none of this is compiled.
+ *
+ * @code{.sh}
+ * > stats
+ * echo: 3 calls, 40 avg, 20 min, 60 max
+ *   16+: 1, 32+: 2
+ * @endcode
+ */
+#define EHSH_CFG_STATS 0
+#endif /* EHSH_CFG_STATS */
+
+#ifndef EHSH_STATS_BUCKETS
+/** Number of log2 latency histogram buckets per command with EHSH_CFG_STATS.
+ * Bucket 0 counts calls of 0 ticks; bucket i counts calls of 2^(i-1) to
+ * 2^i - 1 ticks; the last bucket also counts anything longer.
+ */
+#define EHSH_STATS_BUCKETS 16
+#endif /* EHSH_STATS_BUCKETS */
+
+#ifndef EHSH_CFG_FRAMED
+/** Set to 1 to support framed mode, for host automation rather than people.
+ * It is toggled at runtime with the `f` letter of `stty`. While on, input is
+ * read as COBS-encoded frames, each ending in a 0x00 byte, with no echo or
+ * prompt. A request frame holds:
+ *
+ *   - a sequence number byte, echoed back in the response;
+ *   - the command name, then each argument, separated by '\0' (so arguments
+ *     may hold spaces);
+ *   - a big-endian CRC-16/CCITT-FALSE over all of the above.
+ *
+ * A response frame holds the sequence number, an EhFrameStatus_t byte, the
+ * command's output, then a CRC over all of those. Requests are answered in
+ * order, so a host can send many without waiting. Output is captured through
+ * EhShell.Transport, so the platform hooks must honor it; building with this
+ * set fails unless EHSH_CFG_PLATFORM_TRANSPORT is too.
+ *
+ * @code{.sh}
+ * > stty +f
+ * # Frames only from here on, until a request for ["stty", "-f"]
+ * @endcode
+ */
+#define EHSH_CFG_FRAMED 0
+#endif /* EHSH_CFG_FRAMED */
+
+#ifndef EHSH_FRAME_OUT_SIZE
+/** Bytes of output each response frame can carry with EHSH_CFG_FRAMED; any
+ * more is dropped & the response's status is EHSH_FRAME_TRUNCATED. 1 to 65531.
+ */
+#define EHSH_FRAME_OUT_SIZE 128
+#endif /* EHSH_FRAME_OUT_SIZE */
+
+#ifndef EHSH_CFG_PLATFORM_TRANSPORT
+/** Set to 1 to declare that the platform hooks (EhGetChar(), EhPutChar(),
+ * EhPutStr() & EhFlush()) use EhShell.Transport instead of their own I/O
+ * whenever it is set, as every bundled backend does. Selecting a bundled
+ * backend with the EHSH_CFG_PLATFORM_* macros sets this; define it yourself if
+ * ehsh is built without one, e.g. with hooks of your own or a backend header
+ * included elsewhere. Required by EHSH_CFG_FRAMED.
+ */
+#define EHSH_CFG_PLATFORM_TRANSPORT 0
+#endif /* EHSH_CFG_PLATFORM_TRANSPORT */
+
 #ifndef EHSH_CFG_PLATFORM_FPTR
 /** Defines all platform hook symbols as weak when supported. Default
  * implementations use weak function pointers (which can be overridden):
@@ -94,7 +240,7 @@
 #endif /* EHSH_CFG_PLATFORM_FPTR */
 
 #ifndef EHSH_CFG_PLATFORM_STDC
-/** Uses standard C functions `getchar()`, `putchar()`, and `printf` to
+/** Uses standard C functions `getchar()`, `putchar()`, and `fputs()` to
  * implement the shell. This mode does not support tab completion.
  * This is used on Mac, BSD, Cygwin when EHSH_CFG_PLATFORM_AUTO is set.
  * @see ehsh.stdc.h
@@ -107,6 +253,12 @@
 #define EHSH_CFG_PLATFORM_LINUX 0
 #endif /* EHSH_CFG_PLATFORM_LINUX */
 
+#ifndef EHSH_CFG_PLATFORM_SERVER
+/** Serves a shell per connection on a Unix domain socket from one `epoll`
+ * loop. Never selected by EHSH_CFG_PLATFORM_AUTO. @see eh.server.h */
+#define EHSH_CFG_PLATFORM_SERVER 0
+#endif /* EHSH_CFG_PLATFORM_SERVER */
+
 #ifndef EHSH_CFG_PLATFORM_WIN32
 /** Uses `SetConsoleMode` to configure an interactive shell on Windows. @see ehsh.win32.h */
 #define EHSH_CFG_PLATFORM_WIN32 0
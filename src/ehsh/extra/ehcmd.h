@@ -15,7 +15,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 // std
 #include <stdbool.h>  // true
-#include <string.h>   // strnlen
+#include <string.h>   // memset, strnlen
 
 // local
 #include <ehsh/ehsh.h>
@@ -41,28 +41,45 @@ extern "C" {
  * > help e
  * echo: Prints arguments
  * exit: Exits
+ * # Arguments naming a group of subcommands look within it
+ * > help gpio s
+ * set: Drives a pin
  * @endcode
  */
 static inline void EhHelp(EhShell_t* shell)
 {
-  const char* arg = EhArgAt(shell, 0);
-  if (arg == NULL)
-  {
-    // If no args are provided, a zero length string matches everything
-    arg = "";
-  }
-  size_t prefix = strnlen(arg, EHSH_CMDLINE_SIZE);
+  const EhCommand_t* group = NULL;
+  EhIndex_t          index = 0;
+  bool               more  = true;
 
-  for (size_t i = 0; i < shell->CmdCount; ++i)
+  // Open each group named, so the last argument (if any) is a prefix within it
+  while ((more) && (index < shell->ArgCount))
   {
-    if (strncmp(arg, shell->Cmds[i].Name, prefix) == 0)
+    const char*        arg  = EhArgAt(shell, index);
+    const EhCommand_t* next = (group != NULL) ? EhFindSubcommand(group, arg) : EhFindCommand(shell, arg);
+    more                    = (next != NULL) && (next->Children != NULL);
+    if (more)
     {
-      EhPutStr(shell, shell->Cmds[i].Name);
-      EhPutStr(shell, ": ");
-      EhPutStr(shell, shell->Cmds[i].Help);
-      EhPutNewline(shell);
+      group = next;
+      ++index;
     }
   }
+
+  // If no prefix is left, a zero length string matches everything
+  const char*        arg     = (index < shell->ArgCount) ? EhArgAt(shell, index) : "";
+  const size_t       length  = strnlen(arg, EHSH_CMDLINE_SIZE);
+  const EhCommand_t* cmds    = (group != NULL) ? group->Children : shell->Cmds;
+  uint16_t           first   = 0;
+  const uint16_t     matches = (group != NULL) ? EhFindSubcommands(group, arg, length, &first)
+                                               : EhFindCommands(shell, arg, length, &first);
+
+  for (uint16_t i = first; i < (first + matches); ++i)
+  {
+    EhPutStr(shell, cmds[i].Name);
+    EhPutStr(shell, ": ");
+    EhPutHelp(shell, cmds[i].Help);
+    EhPutNewline(shell);
+  }
 }
 
 /** Stops the shell loop from executing.
@@ -129,6 +146,7 @@ static inline void EhComment(EhShell_t* shell)
  * #   l: Print LF line endings (enable with c for CR/LF).
  * #   r: When set, input newlines end with CR, else ends with LF.
  * #   t: Tty mode (echo typed characters & support tab completion).
+ * #   f: Framed mode, with EHSH_CFG_FRAMED (COBS request/response frames).
  * # Pass no arguments to print the current shell options:
  * > stty
  * +clt
@@ -152,6 +170,9 @@ static inline void EhStty(EhShell_t* shell)
     if (shell->Lf) { EhPutChar(shell, 'l'); }
     if (shell->Eol) { EhPutChar(shell, 'r'); }
     if (shell->Tty) { EhPutChar(shell, 't'); }
+#if EHSH_CFG_FRAMED
+    if (shell->Framed) { EhPutChar(shell, 'f'); }
+#endif /* EHSH_CFG_FRAMED */
     EhPutNewline(shell);
 
     EhPutChar(shell, '-');
@@ -159,6 +180,9 @@ static inline void EhStty(EhShell_t* shell)
     if (!shell->Lf) { EhPutChar(shell, 'l'); }
     if (!shell->Eol) { EhPutChar(shell, 'r'); }
     if (!shell->Tty) { EhPutChar(shell, 't'); }
+#if EHSH_CFG_FRAMED
+    if (!shell->Framed) { EhPutChar(shell, 'f'); }
+#endif /* EHSH_CFG_FRAMED */
     EhPutNewline(shell);
   }
   else
@@ -186,6 +210,11 @@ static inline void EhStty(EhShell_t* shell)
           case 't':
             shell->Tty = value;
             break;
+#if EHSH_CFG_FRAMED
+          case 'f':
+            shell->Framed = value;
+            break;
+#endif /* EHSH_CFG_FRAMED */
           default:
             break;
         }
@@ -194,6 +223,64 @@ static inline void EhStty(EhShell_t* shell)
   }
 }
 
+#if EHSH_CFG_STATS
+/** Prints the timing of every command called since the last `stats`, then
+ * resets them. Durations are in EhTicks(). Below each command, the histogram
+ * gives the number of calls taking at least the given number of ticks (up to
+ * the next bucket).
+ *
+ * @param shell Shell whose EhShell.Stats are printed.
+ *
+ * @code{.sh}
+ * > stats
+ * echo: 3 calls, 40 avg, 20 min, 60 max
+ *   16+: 1, 32+: 2
+ * help: 1 calls, 900 avg, 900 min, 900 max
+ *   512+: 1
+ * @endcode
+ */
+static inline void EhStats(EhShell_t* shell)
+{
+  for (uint16_t i = 0; (shell->Stats != NULL) && (i < shell->CmdCount); ++i)
+  {
+    const EhStats_t* stats = &shell->Stats[i];
+    if (stats->Calls > 0)
+    {
+      EhPutStr(shell, shell->Cmds[i].Name);
+      EhPutStr(shell, ": ");
+      EhPutDecimal(shell, stats->Calls);
+      EhPutStr(shell, " calls, ");
+      EhPutDecimal(shell, (uint32_t)(stats->Total / stats->Calls));
+      EhPutStr(shell, " avg, ");
+      EhPutDecimal(shell, stats->Min);
+      EhPutStr(shell, " min, ");
+      EhPutDecimal(shell, stats->Max);
+      EhPutStr(shell, " max");
+      EhPutNewline(shell);
+
+      const char* separator = "  ";
+      for (uint8_t bucket = 0; bucket < EHSH_STATS_BUCKETS; ++bucket)
+      {
+        if (stats->Histogram[bucket] > 0)
+        {
+          EhPutStr(shell, separator);
+          EhPutDecimal(shell, (bucket == 0) ? 0 : ((uint32_t)1 << (bucket - 1)));
+          EhPutStr(shell, "+: ");
+          EhPutDecimal(shell, stats->Histogram[bucket]);
+          separator = ", ";
+        }
+      }
+      EhPutNewline(shell);
+    }
+  }
+
+  if (shell->Stats != NULL)
+  {
+    memset(shell->Stats, 0, shell->CmdCount * sizeof(*shell->Stats));
+  }
+}
+#endif /* EHSH_CFG_STATS */
+
 ////////////////////////////////////////////////////////////////////////////////
 // $Macros
 ////////////////////////////////////////////////////////////////////////////////
@@ -202,27 +289,35 @@ static inline void EhStty(EhShell_t* shell)
 #define EHSH_HELP_COMMENT "Comment"
 #define EHSH_HELP_STTY "Configure shell EOL, TTY"
 #define EHSH_HELP_EXIT "Quits the shell"
+#define EHSH_HELP_STATS "Prints & resets command timing"
 
-#define EHSH_COMMAND_HELP            \
-  {                                  \
-    "help", EHSH_HELP_HELP, &EhHelp, \
+// Every EhCommand field is given, so -Wmissing-field-initializers stays quiet
+#define EHSH_COMMAND_HELP                           \
+  {                                                 \
+    "help", EHSH_HELP_HELP, &EhHelp, NULL, NULL, 0, \
+  }
+#define EHSH_COMMAND_ECHO                           \
+  {                                                 \
+    "echo", EHSH_HELP_ECHO, &EhEcho, NULL, NULL, 0, \
   }
-#define EHSH_COMMAND_ECHO            \
-  {                                  \
-    "echo", EHSH_HELP_ECHO, &EhEcho, \
+#define EHSH_COMMAND_COMMENT                           \
+  {                                                    \
+    "#", EHSH_HELP_COMMENT, &EhComment, NULL, NULL, 0, \
   }
-#define EHSH_COMMAND_COMMENT            \
-  {                                     \
-    "#", EHSH_HELP_COMMENT, &EhComment, \
+#define EHSH_COMMAND_STTY                           \
+  {                                                 \
+    "stty", EHSH_HELP_STTY, &EhStty, NULL, NULL, 0, \
   }
-#define EHSH_COMMAND_STTY            \
-  {                                  \
-    "stty", EHSH_HELP_STTY, &EhStty, \
+#define EHSH_COMMAND_EXIT                           \
+  {                                                 \
+    "exit", EHSH_HELP_EXIT, &EhExit, NULL, NULL, 0, \
   }
-#define EHSH_COMMAND_EXIT            \
-  {                                  \
-    "exit", EHSH_HELP_EXIT, &EhExit, \
+#if EHSH_CFG_STATS
+#define EHSH_COMMAND_STATS                             \
+  {                                                    \
+    "stats", EHSH_HELP_STATS, &EhStats, NULL, NULL, 0, \
   }
+#endif /* EHSH_CFG_STATS */
 
 #ifdef __cplusplus
 } // extern "C"
@@ -0,0 +1,202 @@
+/** @file
+ * SPDX-License-Identifier: BSL-1.0
+ *
+ * Lock-free single-producer/single-consumer byte ring for interrupt-driven
+ * input: a UART ISR pushes received bytes, and the main loop drains them into
+ * the shell in bulk.
+ *
+ * @code{.c}
+ * static EhRxRing_t Rx;
+ *
+ * void USART1_IRQHandler(void)
+ * {
+ *   EhRxPush(&Rx, (char)USART1->DR);
+ * }
+ *
+ * int main(void)
+ * {
+ *   // ...
+ *   while (!shell.Stop)
+ *   {
+ *     EhRxDrain(&Rx, &shell);
+ *     RunControlTasks();
+ *   }
+ * }
+ * @endcode
+ *
+ * @addtogroup ring
+ * Interrupt-safe input buffering.
+ * @{
+ */
+#ifndef EHSH_RING_H
+#define EHSH_RING_H
+////////////////////////////////////////////////////////////////////////////////
+// $Headers
+////////////////////////////////////////////////////////////////////////////////
+// std
+#include <stdbool.h>  // bool
+#include <stdint.h>   // uint32_t
+
+// local
+#include <ehsh/ehsh.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// $Macros
+////////////////////////////////////////////////////////////////////////////////
+#ifndef EHSH_RX_RING_SIZE
+/** Bytes an EhRxRing_t can hold before EhRxPush() starts dropping input.
+ * Must be a power of two (checked at compile time), so indices wrap with a mask.
+ */
+#define EHSH_RX_RING_SIZE 64
+#endif /* EHSH_RX_RING_SIZE */
+
+#if (EHSH_RX_RING_SIZE < 2) || ((EHSH_RX_RING_SIZE & (EHSH_RX_RING_SIZE - 1)) != 0)
+#error "EHSH_RX_RING_SIZE must be a power of two"
+#endif
+
+#if !defined(EHSH_LOAD_ACQUIRE) && (defined(__GNUC__) || defined(__clang__))
+/// Reads an index written by the other side, before touching the bytes it covers.
+#define EHSH_LOAD_ACQUIRE(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+/// Publishes an index, after the bytes it covers have been written or read.
+#define EHSH_STORE_RELEASE(ptr, value) __atomic_store_n(ptr, value, __ATOMIC_RELEASE)
+#elif !defined(EHSH_LOAD_ACQUIRE)
+// Single-core targets only: aligned 32-bit accesses are atomic, and the indices
+// are volatile. Define both macros with your compiler's barriers otherwise.
+#define EHSH_LOAD_ACQUIRE(ptr) (*(ptr))
+#define EHSH_STORE_RELEASE(ptr, value) (*(ptr) = (value))
+#endif /* EHSH_LOAD_ACQUIRE */
+
+/// Mask wrapping a free-running index into EhRxRing.Buf
+#define EHSH_RX_RING_MASK (EHSH_RX_RING_SIZE - 1U)
+
+////////////////////////////////////////////////////////////////////////////////
+// $Types
+////////////////////////////////////////////////////////////////////////////////
+/** Bytes received but not yet handled by the shell. Zero it before use.
+ * Exactly one context (e.g. an ISR) may push, and exactly one (e.g. the main
+ * loop) may drain; no locks or disabled interrupts are needed.
+ */
+typedef struct EhRxRing {
+  /// Free-running count of bytes pushed; written only by the producer
+  volatile uint32_t Head;
+  /// Free-running count of bytes drained; written only by the consumer
+  volatile uint32_t Tail;
+  /// Bytes dropped because the ring was full; written only by the producer
+  volatile uint32_t Overruns;
+  /// Storage, indexed by Head & Tail masked with EHSH_RX_RING_MASK
+  char Buf[EHSH_RX_RING_SIZE];
+} EhRxRing_t;
+
+////////////////////////////////////////////////////////////////////////////////
+// $Functions
+////////////////////////////////////////////////////////////////////////////////
+/** @brief Pushes as much of a block as fits; the rest is counted as overrun.
+ * Producer side only; safe to call from an ISR, e.g. on DMA half/full transfer.
+ *
+ * @param ring Ring to push to.
+ * @param buf Bytes received.
+ * @param length Number of bytes in buf.
+ * @return Number of bytes pushed.
+ */
+static inline size_t EhRxPushBlock(EhRxRing_t* ring, const char* buf, size_t length)
+{
+  const uint32_t head  = ring->Head;  // Only written here
+  const uint32_t tail  = EHSH_LOAD_ACQUIRE(&ring->Tail);
+  const uint32_t room  = EHSH_RX_RING_SIZE - (head - tail);
+  const size_t   count = (length < room) ? length : room;
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    ring->Buf[(head + i) & EHSH_RX_RING_MASK] = buf[i];
+  }
+  EHSH_STORE_RELEASE(&ring->Head, head + (uint32_t)count);
+  if (count < length)
+  {
+    ring->Overruns = ring->Overruns + (uint32_t)(length - count);
+  }
+
+  return count;
+}
+
+/** @brief Pushes one byte, e.g. from a UART receive interrupt. Producer side only.
+ *
+ * @param ring Ring to push to.
+ * @param chr Byte received.
+ * @return `false` if the ring was full, so chr was dropped & counted as overrun.
+ */
+static inline bool EhRxPush(EhRxRing_t* ring, char chr)
+{
+  return EhRxPushBlock(ring, &chr, 1) == 1;
+}
+
+/** @brief Pops one byte, for use as an EhGetChar() implementation with EhPoll().
+ * Consumer side only.
+ *
+ * @param ring Ring to pop from.
+ * @return Oldest byte pushed, or `(char)-1` if the ring is empty.
+ */
+static inline char EhRxGetChar(EhRxRing_t* ring)
+{
+  const uint32_t tail = ring->Tail;  // Only written here
+  char           chr  = (char)-1;
+
+  if (EHSH_LOAD_ACQUIRE(&ring->Head) != tail)
+  {
+    chr = ring->Buf[tail & EHSH_RX_RING_MASK];
+    EHSH_STORE_RELEASE(&ring->Tail, tail + 1U);
+  }
+
+  return chr;
+}
+
+/** @brief Feeds everything pushed so far into a shell with EhFeed(), in at
+ * most two contiguous runs, so printable runs are echoed in bulk. Bytes the
+ * shell doesn't consume (e.g. while a yielding command has its type-ahead
+ * full) stay in the ring for next time. Consumer side only.
+ *
+ * @param ring Ring to drain.
+ * @param shell Shell handling the input.
+ * @return Number of bytes consumed.
+ */
+static inline size_t EhRxDrain(EhRxRing_t* ring, EhShell_t* shell)
+{
+  const uint32_t head     = EHSH_LOAD_ACQUIRE(&ring->Head);
+  uint32_t       tail     = ring->Tail;  // Only written here
+  size_t         consumed = 0;
+  bool           more     = true;
+
+  while ((more) && (tail != head))
+  {
+    const uint32_t index = tail & EHSH_RX_RING_MASK;
+    const uint32_t ready = head - tail;
+    const uint32_t span  = ((EHSH_RX_RING_SIZE - index) < ready) ? (EHSH_RX_RING_SIZE - index) : ready;
+    const size_t   count = EhFeed(shell, &ring->Buf[index], span);
+
+    tail += (uint32_t)count;
+    consumed += count;
+    more = (count == span);
+    EHSH_STORE_RELEASE(&ring->Tail, tail);
+  }
+
+  return consumed;
+}
+
+/** @brief Number of bytes dropped so far because the ring was full.
+ *
+ * @param ring Ring to query.
+ * @return Total overrun bytes since the ring was zeroed.
+ */
+static inline uint32_t EhRxOverruns(const EhRxRing_t* ring)
+{
+  return ring->Overruns;
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+/** @} */
+#endif /* EHSH_RING_H */
@@ -32,6 +32,10 @@
 EHSH_WEAK char (*EhGetCharFn)(EhShell_t* self)                 = NULL;
 EHSH_WEAK void (*EhPutCharFn)(EhShell_t* self, char chr)       = NULL;
 EHSH_WEAK void (*EhPutStrFn)(EhShell_t* self, const char* chr) = NULL;
+EHSH_WEAK void (*EhFlushFn)(EhShell_t* self)                   = NULL;
+#if EHSH_CFG_STATS
+EHSH_WEAK uint32_t (*EhTicksFn)(EhShell_t* self) = NULL;
+#endif /* EHSH_CFG_STATS */
 
 ////////////////////////////////////////////////////////////////////////////////
 // $Functions
@@ -50,7 +54,11 @@ EHSH_WEAK char EhGetChar(EhShell_t* self)
 {
   char chr = EHSH_ASCII_EOT;
 
-  if (EhGetCharFn != NULL)
+  if (self->Transport != NULL)
+  {
+    chr = EhTransportGetChar(self->Transport);
+  }
+  else if (EhGetCharFn != NULL)
   {
     chr = EhGetCharFn(self);
   }
@@ -60,7 +68,11 @@ EHSH_WEAK char EhGetChar(EhShell_t* self)
 
 EHSH_WEAK void EhPutChar(EhShell_t* self, char chr)
 {
-  if (EhPutCharFn != NULL)
+  if (self->Transport != NULL)
+  {
+    EhTransportPutChar(self->Transport, chr);
+  }
+  else if (EhPutCharFn != NULL)
   {
     EhPutCharFn(self, chr);
   }
@@ -68,7 +80,11 @@ EHSH_WEAK void EhPutChar(EhShell_t* self, char chr)
 
 EHSH_WEAK void EhPutStr(EhShell_t* self, const char* str)
 {
-  if (EhPutStrFn != NULL)
+  if (self->Transport != NULL)
+  {
+    EhTransportPutStr(self->Transport, str);
+  }
+  else if (EhPutStrFn != NULL)
   {
     EhPutStrFn(self, str);
   }
@@ -80,3 +96,29 @@ EHSH_WEAK void EhPutStr(EhShell_t* self, const char* str)
     }
   }
 }
+
+EHSH_WEAK void EhFlush(EhShell_t* self)
+{
+  if (self->Transport != NULL)
+  {
+    EhTransportFlush(self->Transport);
+  }
+  else if (EhFlushFn != NULL)
+  {
+    EhFlushFn(self);
+  }
+}
+
+#if EHSH_CFG_STATS
+EHSH_WEAK uint32_t EhTicks(EhShell_t* self)
+{
+  uint32_t ticks = 0;
+
+  if (EhTicksFn != NULL)
+  {
+    ticks = EhTicksFn(self);
+  }
+
+  return ticks;
+}
+#endif /* EHSH_CFG_STATS */
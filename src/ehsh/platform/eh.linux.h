@@ -12,32 +12,96 @@
 ////////////////////////////////////////////////////////////////////////////////
 // std
 #include <assert.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 
 // 3rd
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <termios.h>
+#include <time.h>
 #include <unistd.h>
 
 // local
 #include <ehsh/ehsh.h>
 
+////////////////////////////////////////////////////////////////////////////////
+// $Macros
+////////////////////////////////////////////////////////////////////////////////
+#ifndef EHSH_LINUX_TX_SIZE
+/** Bytes of output buffered per shell before a `write()` is forced. */
+#define EHSH_LINUX_TX_SIZE 4096
+#endif /* EHSH_LINUX_TX_SIZE */
+
+#ifndef EHSH_LINUX_RX_SIZE
+/** Bytes of input read from stdin per `read()`. */
+#define EHSH_LINUX_RX_SIZE 4096
+#endif /* EHSH_LINUX_RX_SIZE */
+
 ////////////////////////////////////////////////////////////////////////////////
 // $Types
 ////////////////////////////////////////////////////////////////////////////////
+/** Pass to EhConfig.Platform to batch a shell's I/O into as few `read()`s &
+ * `write()`s as possible; without it, every character is a syscall.
+ */
 struct EhPlatform {
-  struct termios LastTermConfig; ///< Previous configuration of the terminal
+  struct termios LastTermConfig;          ///< Previous configuration of the terminal
+  size_t         RxHead;                  ///< Index of the next byte EhGetChar() returns from Rx
+  size_t         RxLength;                ///< Number of bytes read into Rx
+  size_t         TxLength;                ///< Number of bytes pending in Tx
+  char           Rx[EHSH_LINUX_RX_SIZE];  ///< Input read from stdin, but not yet consumed
+  char           Tx[EHSH_LINUX_TX_SIZE];  ///< Output not yet written to stdout
 };
 
+/// Outcome of EhLinuxRunFile().
+typedef struct EhLinuxScript {
+  size_t FailedLine;   ///< 1-based number of the first failing line, or 0 if none failed
+  size_t Lines;        ///< Number of lines processed, including comments & blank lines
+  double Seconds;      ///< Wall-clock time spent running the script
+  double LinesPerSec;  ///< Lines / Seconds
+} EhLinuxScript_t;
+
 ////////////////////////////////////////////////////////////////////////////////
 // $Functions
 ////////////////////////////////////////////////////////////////////////////////
+/** @brief Writes all of buf to stdout, retrying partial writes. */
+static void EhLinuxWrite(const char* buf, size_t length)
+{
+  while (length > 0)
+  {
+    const ssize_t written = write(STDOUT_FILENO, buf, length);
+    if (written > 0)
+    {
+      buf += written;
+      length -= (size_t)written;
+    }
+    else if ((written < 0) && (errno != EINTR))
+    {
+      length = 0;  // Output is gone; nothing sensible left to do
+    }
+  }
+}
+
+static void EhLinuxFlush(EhPlatform_t* platform)
+{
+  if (platform->TxLength > 0)
+  {
+    EhLinuxWrite(platform->Tx, platform->TxLength);
+    platform->TxLength = 0;
+  }
+}
+
 void EhPlatformInit(EhPlatform_t** platform)
 {
   assert(platform != NULL);
 
-  *platform = malloc(sizeof(EhPlatform_t));
+  *platform = (EhPlatform_t*)malloc(sizeof(EhPlatform_t));
   assert(*platform != NULL);
+  (*platform)->RxHead   = 0;
+  (*platform)->RxLength = 0;
+  (*platform)->TxLength = 0;
   // https://man7.org/linux/man-pages/man3/termios.3.html
   // "stty -a"
   tcgetattr(STDIN_FILENO, &(*platform)->LastTermConfig);
@@ -50,31 +114,183 @@ void EhPlatformInit(EhPlatform_t** platform)
 void EhPlatformDeInit(EhPlatform_t** platform)
 {
   assert(platform != NULL);
+  EhLinuxFlush(*platform);
   tcsetattr(STDIN_FILENO, TCSANOW, &(*platform)->LastTermConfig);
   free(*platform);
 }
 
+void EhFlush(EhShell_t* self)
+{
+  EhPlatform_t* platform = self->Platform;
+  if (self->Transport != NULL)
+  {
+    EhTransportFlush(self->Transport);
+  }
+  // Input still pending means the rest of this batch is about to be handled;
+  // EhGetChar() flushes once it runs dry.
+  else if ((platform != NULL) && (platform->RxHead == platform->RxLength))
+  {
+    EhLinuxFlush(platform);
+  }
+}
+
 char EhGetChar(EhShell_t* self)
 {
-  (void)self;
-  char c = EHSH_ASCII_EOT;
-  if (read(STDIN_FILENO, &c, 1) == 0)
+  EhPlatform_t* platform = self->Platform;
+  char          c        = EHSH_ASCII_EOT;
+
+  if (self->Transport != NULL)
   {
-    c = '\0';
+    c = EhTransportGetChar(self->Transport);
   }
+  else if (platform == NULL)
+  {
+    if (read(STDIN_FILENO, &c, 1) == 0)
+    {
+      c = '\0';
+    }
+  }
+  else
+  {
+    if (platform->RxHead == platform->RxLength)
+    {
+      // About to block, so whatever was echoed needs to be seen
+      EhLinuxFlush(platform);
+
+      const ssize_t count = read(STDIN_FILENO, platform->Rx, sizeof(platform->Rx));
+      platform->RxHead    = 0;
+      platform->RxLength  = (count > 0) ? (size_t)count : 0;
+      if (count == 0)
+      {
+        c = '\0';
+      }
+    }
+    if (platform->RxHead < platform->RxLength)
+    {
+      c = platform->Rx[platform->RxHead++];
+    }
+  }
+
   return c;
 }
 
 void EhPutChar(EhShell_t* self, char c)
 {
-  (void)self;
-  write(STDOUT_FILENO, &c, 1);
+  EhPlatform_t* platform = self->Platform;
+  if (self->Transport != NULL)
+  {
+    EhTransportPutChar(self->Transport, c);
+  }
+  else if (platform == NULL)
+  {
+    EhLinuxWrite(&c, 1);
+  }
+  else
+  {
+    if (platform->TxLength == sizeof(platform->Tx))
+    {
+      EhLinuxFlush(platform);
+    }
+    platform->Tx[platform->TxLength++] = c;
+  }
 }
 
 void EhPutStr(EhShell_t* self, const char* str)
+{
+  EhPlatform_t* platform = self->Platform;
+  size_t        length   = strlen(str);
+
+  if (self->Transport != NULL)
+  {
+    EhTransportPutStr(self->Transport, str);
+  }
+  else if (platform == NULL)
+  {
+    EhLinuxWrite(str, length);
+  }
+  else if (length > (sizeof(platform->Tx) - platform->TxLength))
+  {
+    // Doesn't fit: keep output in order, then send the string directly
+    EhLinuxFlush(platform);
+    EhLinuxWrite(str, length);
+  }
+  else
+  {
+    memcpy(&platform->Tx[platform->TxLength], str, length);
+    platform->TxLength += length;
+  }
+}
+
+/** @brief Memory-maps a script file & runs it with EhRunScript().
+ *
+ * @code{.c}
+ * EhLinuxScript_t script;
+ * if ((EhLinuxRunFile(&shell, "provision.ehsh", &script) == 0) && (script.FailedLine != 0))
+ * {
+ *   fprintf(stderr, "line %zu failed\n", script.FailedLine);
+ * }
+ * @endcode
+ *
+ * @param self Shell whose commands run the script.
+ * @param path Path of the script file.
+ * @param[out] result Failing line, line count & throughput of the run.
+ * @return 0 if the script ran (even if a line failed), or -1 with `errno` set
+ * if the file could not be opened or mapped.
+ */
+int EhLinuxRunFile(EhShell_t* self, const char* path, EhLinuxScript_t* result)
+{
+  int         status = -1;
+  struct stat info;
+  const int   fd = open(path, O_RDONLY | O_CLOEXEC);
+
+  memset(result, 0, sizeof(*result));
+  if ((fd >= 0) && (fstat(fd, &info) == 0))
+  {
+    const size_t length = (size_t)info.st_size;
+    const char*  script = "";
+    if (length > 0)
+    {
+      script = (const char*)mmap(NULL, length, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    }
+
+    if (script != MAP_FAILED)
+    {
+      struct timespec start;
+      struct timespec stop;
+      if (length > 0)
+      {
+        posix_madvise((void*)script, length, POSIX_MADV_SEQUENTIAL);
+      }
+
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      result->FailedLine = EhRunScript(self, script, length, &result->Lines);
+      clock_gettime(CLOCK_MONOTONIC, &stop);
+
+      result->Seconds     = (double)(stop.tv_sec - start.tv_sec) + ((double)(stop.tv_nsec - start.tv_nsec) / 1e9);
+      result->LinesPerSec = (result->Seconds > 0) ? ((double)result->Lines / result->Seconds) : 0;
+      status              = 0;
+      if (length > 0)
+      {
+        munmap((void*)script, length);
+      }
+    }
+  }
+  if (fd >= 0)
+  {
+    close(fd);
+  }
+
+  return status;
+}
+
+#if EHSH_CFG_STATS
+uint32_t EhTicks(EhShell_t* self)
 {
   (void)self;
-  write(STDOUT_FILENO, str, strnlen(str, 0xFF));
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)(((uint64_t)now.tv_sec * 1000000U) + ((uint64_t)now.tv_nsec / 1000U));
 }
+#endif /* EHSH_CFG_STATS */
 
 #endif /* EHSH_LINUX_H */
@@ -28,12 +28,20 @@
   #endif
 #endif
 
+#if EHSH_CFG_PLATFORM_FPTR || EHSH_CFG_PLATFORM_STDC || EHSH_CFG_PLATFORM_LINUX || EHSH_CFG_PLATFORM_SERVER || EHSH_CFG_PLATFORM_WIN32
+  // Every bundled backend honors EhShell.Transport
+  #undef EHSH_CFG_PLATFORM_TRANSPORT
+  #define EHSH_CFG_PLATFORM_TRANSPORT 1
+#endif
+
 #if EHSH_CFG_PLATFORM_FPTR
 #include <ehsh/platform/eh.fptr.h>
 #elif EHSH_CFG_PLATFORM_STDC
 #include <ehsh/platform/eh.stdc.h>
 #elif EHSH_CFG_PLATFORM_LINUX
 #include <ehsh/platform/eh.linux.h>
+#elif EHSH_CFG_PLATFORM_SERVER
+#include <ehsh/platform/eh.server.h>
 #elif EHSH_CFG_PLATFORM_WIN32
 #include <ehsh/platform/eh.win32.h>
 #endif
@@ -0,0 +1,533 @@
+/**
+ * @addtogroup platform
+ * @{
+ *
+ * @file
+ * SPDX-License-Identifier: BSL-1.0
+ *
+ * Serves one shell per connection on a Unix domain socket, all driven from a
+ * single thread by `epoll`. Sessions are preallocated by the caller, so memory
+ * per session is constant (sizeof(EhSession_t)) whether it is busy or idle.
+ * Commands that call EhYield() are resumed once per EhServerPoll(), which
+ * doesn't wait for activity while any are running.
+ *
+ * @code{.c}
+ * static EhSession_t sessions[1000];
+ * EhServer_t         server;
+ * EhServerInit(&server, "/run/ehsh.sock", sessions, 1000, &config);
+ * while (EhServerPoll(&server, -1) >= 0) {}
+ * EhServerDeInit(&server);
+ * @endcode
+ */
+#ifndef EHSH_SERVER_H
+#define EHSH_SERVER_H
+////////////////////////////////////////////////////////////////////////////////
+// $Headers
+////////////////////////////////////////////////////////////////////////////////
+// std
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// 3rd
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+// local
+#include <ehsh/ehsh.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// $Macros
+////////////////////////////////////////////////////////////////////////////////
+#ifndef EHSH_SERVER_TX_SIZE
+/** Bytes of output buffered per session. Output that cannot be sent because
+ * the peer isn't reading and this buffer is full is dropped. */
+#define EHSH_SERVER_TX_SIZE 1024
+#endif /* EHSH_SERVER_TX_SIZE */
+
+#ifndef EHSH_SERVER_RX_SIZE
+/** Bytes read per `read()`; this buffer is on the stack, not per session. */
+#define EHSH_SERVER_RX_SIZE 1024
+#endif /* EHSH_SERVER_RX_SIZE */
+
+#ifndef EHSH_SERVER_HOLD_SIZE
+/** Bytes of input held per session while its running command's type-ahead is
+ * full, then fed to its shell as that makes room. Input beyond this is
+ * dropped, except a Ctrl-C, which discards the input before it anyway. */
+#define EHSH_SERVER_HOLD_SIZE 256
+#endif /* EHSH_SERVER_HOLD_SIZE */
+
+#ifndef EHSH_SERVER_EVENTS
+/** Maximum number of `epoll` events handled per EhServerPoll(). */
+#define EHSH_SERVER_EVENTS 64
+#endif /* EHSH_SERVER_EVENTS */
+
+/// epoll_event.data.u32 of the listening socket
+#define EHSH_SERVER_LISTENER UINT32_MAX
+
+/// Ends the lists of busy & free sessions
+#define EHSH_SERVER_END UINT32_MAX
+
+////////////////////////////////////////////////////////////////////////////////
+// $Types
+////////////////////////////////////////////////////////////////////////////////
+/// Per-connection I/O state, used as the EhShell.Platform of each session.
+struct EhPlatform {
+  int      Fd;                           ///< Connected socket, or -1 if the session is free
+  bool     Waiting;                      ///< Whether epoll is watching Fd for EPOLLOUT
+  bool     Busy;                         ///< Whether the session is on EhServer.Busy
+  uint32_t NextBusy;                     ///< Next session on EhServer.Busy, or EHSH_SERVER_END
+  uint32_t NextFree;                     ///< Next session on EhServer.Free, or EHSH_SERVER_END
+  uint32_t Dropped;                      ///< Bytes of output discarded because the peer stopped reading
+  size_t   TxLength;                     ///< Number of bytes pending in Tx
+  char     Tx[EHSH_SERVER_TX_SIZE];      ///< Output not yet written to Fd
+  size_t   HeldLength;                   ///< Number of bytes pending in Held
+  char     Held[EHSH_SERVER_HOLD_SIZE];  ///< Input the shell couldn't take yet
+};
+
+/// A connection & its shell. The shell's EhShell.Context is the EhServer_t serving it.
+typedef struct EhSession {
+  EhShell_t    Shell;     ///< Shell serving this connection
+  EhPlatform_t Platform;  ///< I/O state for this connection
+} EhSession_t;
+
+/// Listening socket, epoll instance, and the pool of sessions they serve.
+typedef struct EhServer {
+  int          ListenFd;      ///< Listening Unix domain socket
+  int          EpollFd;       ///< epoll instance watching ListenFd & every session
+  EhSession_t* Sessions;      ///< Caller-provided session pool
+  uint32_t     SessionCount;  ///< Number of Sessions
+  uint32_t     Active;        ///< Number of Sessions currently connected
+  uint32_t     Busy;          ///< First session whose command is running, or EHSH_SERVER_END
+  uint32_t     Free;          ///< First session not connected, or EHSH_SERVER_END
+  EhConfig_t   Config;        ///< Configuration each session's shell is created with
+} EhServer_t;
+
+////////////////////////////////////////////////////////////////////////////////
+// $Functions
+////////////////////////////////////////////////////////////////////////////////
+void EhPlatformInit(EhPlatform_t** platform)
+{
+  (void)platform;
+}
+
+void EhPlatformDeInit(EhPlatform_t** platform)
+{
+  (void)platform;
+}
+
+/** @brief Writes as much of Tx as the socket accepts without blocking.
+ * @return `true` if Tx is now empty.
+ */
+static bool EhServerSend(EhPlatform_t* platform)
+{
+  size_t sent = 0;
+  bool   busy = false;
+
+  while ((!busy) && (sent < platform->TxLength))
+  {
+    const ssize_t count = send(platform->Fd, &platform->Tx[sent], platform->TxLength - sent, MSG_NOSIGNAL);
+    if (count > 0)
+    {
+      sent += (size_t)count;
+    }
+    else if ((count < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+    {
+      busy = true;
+    }
+    else if ((count < 0) && (errno != EINTR))
+    {
+      sent = platform->TxLength;  // Peer is gone; the hangup is handled by epoll
+    }
+  }
+
+  memmove(&platform->Tx[0], &platform->Tx[sent], platform->TxLength - sent);
+  platform->TxLength -= sent;
+  return platform->TxLength == 0;
+}
+
+/** @brief Sends pending output, watching for EPOLLOUT only while some remains. */
+static void EhServerFlush(EhServer_t* server, uint32_t index)
+{
+  EhPlatform_t* platform = &server->Sessions[index].Platform;
+  const bool    waiting  = !EhServerSend(platform);
+  if (waiting != platform->Waiting)
+  {
+    struct epoll_event event;
+    event.events      = EPOLLIN | EPOLLRDHUP | (waiting ? EPOLLOUT : 0);
+    event.data.u32    = index;
+    platform->Waiting = waiting;
+    epoll_ctl(server->EpollFd, EPOLL_CTL_MOD, platform->Fd, &event);
+  }
+}
+
+char EhGetChar(EhShell_t* self)
+{
+  // Otherwise, input is pushed in by EhServerPoll()
+  return (self->Transport != NULL) ? EhTransportGetChar(self->Transport) : (char)-1;
+}
+
+void EhPutChar(EhShell_t* self, char c)
+{
+  EhPlatform_t* platform = self->Platform;
+  if (self->Transport != NULL)
+  {
+    EhTransportPutChar(self->Transport, c);
+  }
+  else if ((platform->TxLength == sizeof(platform->Tx)) && (!EhServerSend(platform)))
+  {
+    ++platform->Dropped;
+  }
+  else
+  {
+    platform->Tx[platform->TxLength++] = c;
+  }
+}
+
+void EhPutStr(EhShell_t* self, const char* str)
+{
+  if (self->Transport != NULL)
+  {
+    EhTransportPutStr(self->Transport, str);
+  }
+  else
+  {
+    for (size_t i = 0; str[i] != '\0'; ++i)
+    {
+      EhPutChar(self, str[i]);
+    }
+  }
+}
+
+void EhFlush(EhShell_t* self)
+{
+  if (self->Transport != NULL)
+  {
+    EhTransportFlush(self->Transport);
+  }
+  else
+  {
+    (void)EhServerSend(self->Platform);
+  }
+}
+
+/** @brief Feeds input to a session's shell, after any it holds. Whatever the
+ * shell can't take yet is held, up to EHSH_SERVER_HOLD_SIZE bytes.
+ */
+static void EhServerFeed(EhSession_t* session, const char* buf, size_t length)
+{
+  EhPlatform_t* platform = &session->Platform;
+  const char*   etx      = (const char*)memchr(buf, EHSH_ASCII_ETX, length);
+  size_t        fed      = 0;
+
+  // A Ctrl-C discards the input typed ahead of it, held or not
+  if ((platform->HeldLength > 0) && (etx != NULL))
+  {
+    platform->HeldLength = 0;
+    length -= (size_t)(etx - buf);
+    buf = etx;
+  }
+
+  if (platform->HeldLength == 0)
+  {
+    fed = EhFeed(&session->Shell, buf, length);
+  }
+  else
+  {
+    const size_t room = sizeof(platform->Held) - platform->HeldLength;
+    const size_t take = (length < room) ? length : room;
+    memcpy(&platform->Held[platform->HeldLength], buf, take);
+    platform->HeldLength += take;
+    fed = length;  // Anything past the held input is dropped
+
+    const size_t replayed = EhFeed(&session->Shell, platform->Held, platform->HeldLength);
+    memmove(&platform->Held[0], &platform->Held[replayed], platform->HeldLength - replayed);
+    platform->HeldLength -= replayed;
+  }
+
+  if (fed < length)
+  {
+    const size_t rest = length - fed;
+    const size_t take = (rest < sizeof(platform->Held)) ? rest : sizeof(platform->Held);
+    memcpy(&platform->Held[0], &buf[fed], take);
+    platform->HeldLength = take;
+  }
+}
+
+/** @brief Puts a session whose command is running on the busy list, once. */
+static void EhServerMarkBusy(EhServer_t* server, uint32_t index)
+{
+  EhPlatform_t* platform = &server->Sessions[index].Platform;
+  if ((server->Sessions[index].Shell.Running != NULL) && (!platform->Busy))
+  {
+    platform->Busy     = true;
+    platform->NextBusy = server->Busy;
+    server->Busy       = index;
+  }
+}
+
+static void EhServerClose(EhServer_t* server, uint32_t index)
+{
+  EhSession_t* session = &server->Sessions[index];
+  (void)EhServerSend(&session->Platform);
+  epoll_ctl(server->EpollFd, EPOLL_CTL_DEL, session->Platform.Fd, NULL);
+  close(session->Platform.Fd);
+  EhDeInit(&session->Shell);
+  session->Platform.Fd         = -1;
+  session->Platform.HeldLength = 0;
+  session->Platform.NextFree   = server->Free;
+  server->Free                 = index;
+  --server->Active;
+}
+
+/** @brief Accepts a connection as non-blocking (`accept4()` needs _GNU_SOURCE). */
+static int EhServerAcceptOne(EhServer_t* server)
+{
+  const int fd = accept(server->ListenFd, NULL, NULL);
+  if (fd >= 0)
+  {
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+  }
+  return fd;
+}
+
+static void EhServerAccept(EhServer_t* server)
+{
+  int fd = EhServerAcceptOne(server);
+  while (fd >= 0)
+  {
+    const uint32_t index = server->Free;
+    if ((index == EHSH_SERVER_END) || (EhInit(&server->Sessions[index].Shell, &server->Config) == NULL))
+    {
+      close(fd);  // Full, or the command table is invalid
+    }
+    else
+    {
+      EhSession_t* session = &server->Sessions[index];
+      server->Free               = session->Platform.NextFree;
+      session->Shell.Context     = server;
+      session->Shell.Platform    = &session->Platform;
+      session->Shell.Transport   = NULL;
+      session->Platform.Fd       = fd;
+      session->Platform.Waiting  = false;
+      session->Platform.Dropped    = 0;
+      session->Platform.TxLength   = 0;
+      session->Platform.HeldLength = 0;
+      ++server->Active;
+
+      struct epoll_event event;
+      event.events   = EPOLLIN | EPOLLRDHUP;
+      event.data.u32 = index;
+      epoll_ctl(server->EpollFd, EPOLL_CTL_ADD, fd, &event);
+
+      (void)EhFeed(&session->Shell, "", 0);  // Prompt
+      EhServerFlush(server, index);
+    }
+
+    fd = EhServerAcceptOne(server);
+  }
+}
+
+static void EhServerReceive(EhServer_t* server, uint32_t index)
+{
+  EhSession_t* session = &server->Sessions[index];
+  char         buf[EHSH_SERVER_RX_SIZE];
+  bool         open = true;
+  ssize_t      count;
+
+  do
+  {
+    count = read(session->Platform.Fd, buf, sizeof(buf));
+    if (count > 0)
+    {
+      EhServerFeed(session, buf, (size_t)count);
+      open = !session->Shell.Stop;
+    }
+    else if ((count == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)))
+    {
+      open = false;
+    }
+  } while ((open) && (count == (ssize_t)sizeof(buf)));
+
+  if (open)
+  {
+    EhServerFlush(server, index);
+    EhServerMarkBusy(server, index);
+  }
+  else
+  {
+    EhServerClose(server, index);
+  }
+}
+
+/** @brief Resumes each session's running command once, feeding it any input
+ * it holds. Those still running stay on the busy list.
+ */
+static void EhServerStep(EhServer_t* server)
+{
+  uint32_t index = server->Busy;
+  server->Busy   = EHSH_SERVER_END;
+
+  while (index != EHSH_SERVER_END)
+  {
+    EhSession_t*   session = &server->Sessions[index];
+    const uint32_t next    = session->Platform.NextBusy;
+    session->Platform.Busy = false;
+
+    // Closed since, or finished by input that arrived meanwhile
+    if ((session->Platform.Fd >= 0) && (session->Shell.Running != NULL))
+    {
+      EhServerFeed(session, "", 0);
+      if (session->Shell.Stop)
+      {
+        EhServerClose(server, index);
+      }
+      else
+      {
+        EhServerFlush(server, index);
+        EhServerMarkBusy(server, index);
+      }
+    }
+    index = next;
+  }
+}
+
+/** @brief Starts listening on a Unix domain socket.
+ *
+ * @param server Server to initialize.
+ * @param path Filesystem path of the socket; any existing file there is removed.
+ * @param sessions Pool of sessions; each connection gets one, until they run out.
+ * @param count Number of sessions.
+ * @param config Configuration for every session's shell. EhConfig.Platform &
+ * EhConfig.Transport are ignored, as each session does I/O on its socket.
+ * @return 0 on success, or -1 with `errno` set; `EINVAL` if EhInit() rejects
+ * the configuration.
+ */
+int EhServerInit(EhServer_t* server, const char* path, EhSession_t* sessions, uint32_t count, const EhConfig_t* config)
+{
+  int result = -1;
+
+  memset(server, 0, sizeof(*server));
+  server->Sessions     = sessions;
+  server->SessionCount = count;
+  server->Busy         = EHSH_SERVER_END;
+  server->Free         = EHSH_SERVER_END;
+  server->Config       = *config;
+  for (uint32_t i = count; i > 0; --i)  // Lowest index first
+  {
+    sessions[i - 1].Platform.Fd         = -1;
+    sessions[i - 1].Platform.Busy       = false;
+    sessions[i - 1].Platform.HeldLength = 0;
+    sessions[i - 1].Platform.NextFree   = server->Free;
+    server->Free                        = i - 1;
+  }
+  server->ListenFd = -1;
+  server->EpollFd  = -1;
+
+  // Check the command table once, rather than failing every connection
+  EhShell_t probe;
+  if (EhInit(&probe, config) == NULL)
+  {
+    errno = EINVAL;
+  }
+  else
+  {
+    EhDeInit(&probe);
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path);
+
+    server->ListenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    server->EpollFd  = epoll_create1(EPOLL_CLOEXEC);
+    if ((server->ListenFd >= 0) && (server->EpollFd >= 0) &&
+        (bind(server->ListenFd, (const struct sockaddr*)&addr, sizeof(addr)) == 0) &&
+        (listen(server->ListenFd, SOMAXCONN) == 0))
+    {
+      struct epoll_event event;
+      event.events   = EPOLLIN;
+      event.data.u32 = EHSH_SERVER_LISTENER;
+      result         = epoll_ctl(server->EpollFd, EPOLL_CTL_ADD, server->ListenFd, &event);
+    }
+  }
+
+  return result;
+}
+
+/** @brief Waits for activity, then accepts connections, feeds input to
+ * sessions' shells, and sends their output. Then each command that called
+ * EhYield() is resumed once. Sessions whose shell stops or whose peer hangs up
+ * are closed.
+ *
+ * @param server Server to run.
+ * @param timeout Milliseconds to wait for activity; 0 returns immediately, -1 waits forever.
+ * Treated as 0 while any session's command is running.
+ * @return Number of events handled, or -1 on error.
+ */
+int EhServerPoll(EhServer_t* server, int timeout)
+{
+  struct epoll_event events[EHSH_SERVER_EVENTS];
+  const int          wait  = (server->Busy != EHSH_SERVER_END) ? 0 : timeout;
+  const int          count = epoll_wait(server->EpollFd, events, EHSH_SERVER_EVENTS, wait);
+
+  for (int i = 0; i < count; ++i)
+  {
+    const uint32_t index = events[i].data.u32;
+    if (index == EHSH_SERVER_LISTENER)
+    {
+      EhServerAccept(server);
+    }
+    else if (server->Sessions[index].Platform.Fd >= 0)
+    {
+      if (events[i].events & EPOLLIN)
+      {
+        EhServerReceive(server, index);
+      }
+      else if (events[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+      {
+        EhServerClose(server, index);
+      }
+      else if (events[i].events & EPOLLOUT)
+      {
+        EhServerFlush(server, index);
+      }
+    }
+  }
+  EhServerStep(server);
+
+  return ((count < 0) && (errno == EINTR)) ? 0 : count;
+}
+
+/** @brief Closes every session & the listening socket. */
+void EhServerDeInit(EhServer_t* server)
+{
+  for (uint32_t i = 0; i < server->SessionCount; ++i)
+  {
+    if (server->Sessions[i].Platform.Fd >= 0)
+    {
+      EhServerClose(server, i);
+    }
+  }
+  close(server->EpollFd);
+  close(server->ListenFd);
+}
+
+#if EHSH_CFG_STATS
+uint32_t EhTicks(EhShell_t* self)
+{
+  (void)self;
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)(((uint64_t)now.tv_sec * 1000000U) + ((uint64_t)now.tv_nsec / 1000U));
+}
+#endif /* EHSH_CFG_STATS */
+
+#endif /* EHSH_SERVER_H */
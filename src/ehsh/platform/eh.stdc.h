@@ -14,6 +14,7 @@
 // std
 #include <stdint.h>
 #include <stdio.h>
+#include <time.h>
 
 // local
 #include <ehsh/ehsh.h>
@@ -33,20 +34,51 @@ void EhPlatformDeInit(EhPlatform_t** platform)
 
 char EhGetChar(EhShell_t* self)
 {
-  (void)self;
-  return (char)getchar();
+  return (self->Transport != NULL) ? EhTransportGetChar(self->Transport) : (char)getchar();
 }
 
 void EhPutChar(EhShell_t* self, char chr)
 {
-  (void)self;
-  putchar(chr);
+  if (self->Transport != NULL)
+  {
+    EhTransportPutChar(self->Transport, chr);
+  }
+  else
+  {
+    putchar(chr);
+  }
 }
 
 void EhPutStr(EhShell_t* self, const char* str)
+{
+  if (self->Transport != NULL)
+  {
+    EhTransportPutStr(self->Transport, str);
+  }
+  else
+  {
+    fputs(str, stdout);
+  }
+}
+
+void EhFlush(EhShell_t* self)
+{
+  if (self->Transport != NULL)
+  {
+    EhTransportFlush(self->Transport);
+  }
+  else
+  {
+    fflush(stdout);
+  }
+}
+
+#if EHSH_CFG_STATS
+uint32_t EhTicks(EhShell_t* self)
 {
   (void)self;
-  printf("%s", str);
+  return (uint32_t)(((uint64_t)clock() * 1000000U) / CLOCKS_PER_SEC);  // Processor time
 }
+#endif /* EHSH_CFG_STATS */
 
 #endif /* EHSH_STDC_H */
@@ -63,22 +63,28 @@ void EhPlatformDeInit(EhPlatform_t** platform)
 
 char EhGetChar(EhShell_t* self)
 {
-  (void)self;
   char c = '\0';
 
-  HANDLE hstdin = GetStdHandle(STD_INPUT_HANDLE);
-  assert(hstdin != INVALID_HANDLE_VALUE);
+  if (self->Transport != NULL)
+  {
+    c = EhTransportGetChar(self->Transport);
+  }
+  else
+  {
+    HANDLE hstdin = GetStdHandle(STD_INPUT_HANDLE);
+    assert(hstdin != INVALID_HANDLE_VALUE);
 
-  INPUT_RECORD record;
-  memset(&record, 0, sizeof(record));
-  DWORD count = 0;
+    INPUT_RECORD record;
+    memset(&record, 0, sizeof(record));
+    DWORD count = 0;
 
-  while (c == '\0')
-  {
-    BOOL ok = ReadConsoleInput(hstdin, &record, 1, &count);
-    if ((ok) && (count == 1) && (record.EventType == KEY_EVENT) && (record.Event.KeyEvent.bKeyDown))
+    while (c == '\0')
     {
-      c = record.Event.KeyEvent.uChar.AsciiChar;
+      BOOL ok = ReadConsoleInput(hstdin, &record, 1, &count);
+      if ((ok) && (count == 1) && (record.EventType == KEY_EVENT) && (record.Event.KeyEvent.bKeyDown))
+      {
+        c = record.Event.KeyEvent.uChar.AsciiChar;
+      }
     }
   }
 
@@ -87,7 +93,11 @@ char EhGetChar(EhShell_t* self)
 
 void EhPutChar(EhShell_t* self, char c)
 {
-  if ((self->Cursor == 0) && (c == EHSH_ASCII_BS))
+  if (self->Transport != NULL)
+  {
+    EhTransportPutChar(self->Transport, c);
+  }
+  else if ((self->Cursor == 0) && (c == EHSH_ASCII_BS))
   {
     // TODO: That ain't right
     printf("lmao");
@@ -99,9 +109,40 @@ void EhPutChar(EhShell_t* self, char c)
 }
 
 void EhPutStr(EhShell_t* self, const char* str)
+{
+  if (self->Transport != NULL)
+  {
+    EhTransportPutStr(self->Transport, str);
+  }
+  else
+  {
+    fputs(str, stdout);
+  }
+}
+
+void EhFlush(EhShell_t* self)
+{
+  if (self->Transport != NULL)
+  {
+    EhTransportFlush(self->Transport);
+  }
+  else
+  {
+    fflush(stdout);
+  }
+}
+
+#if EHSH_CFG_STATS
+uint32_t EhTicks(EhShell_t* self)
 {
   (void)self;
-  printf("%s", str);
+  LARGE_INTEGER now;
+  LARGE_INTEGER frequency;
+  QueryPerformanceCounter(&now);
+  QueryPerformanceFrequency(&frequency);
+  // Whole seconds & the remainder apart, so scaling can't overflow
+  return (uint32_t)(((now.QuadPart / frequency.QuadPart) * 1000000) + (((now.QuadPart % frequency.QuadPart) * 1000000) / frequency.QuadPart));
 }
+#endif /* EHSH_CFG_STATS */
 
 #endif /* EHSH_WIN32_H */
@@ -0,0 +1,405 @@
+/** @file
+ * SPDX-License-Identifier: BSL-1.0
+ *
+ * Microbenchmarks of the shell's hot paths through an in-memory fptr
+ * transport. This is built with its own copy of ehsh whose command line is 255
+ * characters, so line length can be varied. Run the `bench.json` target to
+ * save results for comparison between commits, e.g. with Google Benchmark's
+ * `tools/compare.py benchmarks old.json new.json`.
+ */
+////////////////////////////////////////////////////////////////////////////////
+// $Headers
+////////////////////////////////////////////////////////////////////////////////
+// std
+#include <algorithm>   // std::sort
+#include <cstdio>      // snprintf
+#include <cstdlib>     // std::abs
+#include <cstring>     // strlen
+#include <filesystem>  // std::filesystem
+#include <fstream>     // std::ifstream
+#include <iterator>    // std::istreambuf_iterator
+#include <string>      // std::string
+#include <vector>      // std::vector
+
+// 3rd
+#include <benchmark/benchmark.h>
+
+// local
+#include "fuzz.h"
+#include <ehsh/ehsh.h>
+#include <ehsh/extra/ehcmd.h>
+#include <ehsh/platform/eh.fptr.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// $Globals
+////////////////////////////////////////////////////////////////////////////////
+const static EhCommand_t BUILTIN_COMMANDS[] = {
+  EHSH_COMMAND_COMMENT,
+  EHSH_COMMAND_ECHO,
+  EHSH_COMMAND_EXIT,
+  EHSH_COMMAND_HELP,
+  EHSH_COMMAND_STTY,
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// $Functions
+////////////////////////////////////////////////////////////////////////////////
+/// In-memory transport: reads from Input, discards output.
+struct Transport {
+  std::string Input{};
+  size_t      Read{};
+  size_t      Written{};
+
+  static char GetChar(EhShell_t* shell)
+  {
+    auto& self = *static_cast<Transport*>(shell->Context);
+    return (self.Read < self.Input.size()) ? self.Input[self.Read++] : static_cast<char>(EHSH_ASCII_EOT);
+  }
+
+  static void PutChar(EhShell_t* shell, char chr)
+  {
+    (void)chr;
+    ++static_cast<Transport*>(shell->Context)->Written;
+  }
+
+  static void PutStr(EhShell_t* shell, const char* str)
+  {
+    static_cast<Transport*>(shell->Context)->Written += strlen(str);
+  }
+};
+
+static std::string MakeLines(size_t bytes)
+{
+  std::string input;
+  while (input.size() < bytes)
+  {
+    input += "# x\r\necho a b c\r\nech" EHSH_BACKSPACE "o xyz\r\n";
+  }
+  return input;
+}
+
+/// Command callback that only touches its last argument.
+static void Sink(EhShell_t* shell)
+{
+  benchmark::DoNotOptimize(EhArgAt(shell, shell->ArgCount - 1));
+}
+
+/// Sorted table of commands named "cmd0000", "cmd0001", ..., all calling Sink().
+struct Table {
+  std::vector<std::string> Names;
+  std::vector<EhCommand_t> Commands;
+
+  explicit Table(size_t size)
+  {
+    for (size_t i = 0; i < size; ++i)
+    {
+      char name[16];
+      snprintf(name, sizeof(name), "cmd%04zu", i);
+      Names.emplace_back(name);
+    }
+    for (const std::string& name : Names)
+    {
+      Commands.push_back({ name.c_str(), "", &Sink });
+    }
+  }
+
+  /// A name spread evenly over the table, so lookups don't all hit one spot.
+  const std::string& Pick(size_t i) const
+  {
+    return Names[(i * 7919) % Names.size()];
+  }
+};
+
+/// Counter reporting time per item (e.g. per byte or per dispatch), printed like "110ns".
+static benchmark::Counter TimePer(double items)
+{
+  return benchmark::Counter(items, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+static void InitShell(
+  EhShell_t&         shell,
+  Transport&         transport,
+  const EhCommand_t* commands = &BUILTIN_COMMANDS[0],
+  size_t             count    = std::size(BUILTIN_COMMANDS),
+  bool               tty      = true)
+{
+  EhGetCharFn = &Transport::GetChar;
+  EhPutCharFn = &Transport::PutChar;
+  EhPutStrFn  = &Transport::PutStr;
+
+  const EhConfig_t cfg = {
+    .Commands     = commands,
+    .CommandCount = static_cast<uint16_t>(count),
+    .Eol          = EHSH_EOL_LF,
+    .Tty          = tty,
+    .Cr           = true,
+    .Lf           = true,
+  };
+  EhInit(&shell, &cfg);
+  shell.Context = &transport;
+}
+
+/// Bytes pulled one at a time through EhGetChar() by EhExec().
+static void BM_ExecPerChar(benchmark::State& state)
+{
+  Transport transport;
+  transport.Input = MakeLines(state.range(0));
+  EhShell_t shell;
+
+  for (auto _ : state)
+  {
+    InitShell(shell, transport);
+    transport.Read = 0;
+    EhExec(&shell);
+  }
+
+  state.SetBytesProcessed(state.iterations() * transport.Input.size());
+  state.counters["per_byte"] = TimePer(state.iterations() * transport.Input.size());
+}
+BENCHMARK(BM_ExecPerChar)->Arg(4096)->Arg(65536);
+
+/// Whole buffers handed to EhFeed().
+static void BM_Feed(benchmark::State& state)
+{
+  Transport transport;
+  transport.Input = MakeLines(state.range(0));
+  EhShell_t shell;
+
+  for (auto _ : state)
+  {
+    InitShell(shell, transport);
+    benchmark::DoNotOptimize(EhFeed(&shell, transport.Input.data(), transport.Input.size()));
+  }
+
+  state.SetBytesProcessed(state.iterations() * transport.Input.size());
+  state.counters["per_byte"] = TimePer(state.iterations() * transport.Input.size());
+}
+BENCHMARK(BM_Feed)->Arg(4096)->Arg(65536);
+
+/// Whole buffers run as a script by EhRunScript(); no echo or prompts.
+static void BM_RunScript(benchmark::State& state)
+{
+  Transport transport;
+  while (transport.Input.size() < static_cast<size_t>(state.range(0)))
+  {
+    transport.Input += "# x\r\necho a b c\r\necho xyz\r\n";  // MakeLines(), less the typo
+  }
+  EhShell_t shell;
+
+  for (auto _ : state)
+  {
+    InitShell(shell, transport);
+    benchmark::DoNotOptimize(EhRunScript(&shell, transport.Input.data(), transport.Input.size(), nullptr));
+  }
+
+  state.SetBytesProcessed(state.iterations() * transport.Input.size());
+  state.counters["per_byte"] = TimePer(state.iterations() * transport.Input.size());
+}
+BENCHMARK(BM_RunScript)->Arg(4096)->Arg(65536);
+
+/// Lines of a given length, each "echo" plus 7-character arguments, fed in bulk.
+static void BM_FeedLineLength(benchmark::State& state)
+{
+  const size_t length = static_cast<size_t>(state.range(0));
+  std::string  line   = "echo";
+  while (line.size() + 8 <= length)
+  {
+    line += " xxxxxxx";
+  }
+  line.resize(length, 'x');
+  line += "\n";
+
+  Transport transport;
+  while (transport.Input.size() < 65536)
+  {
+    transport.Input += line;
+  }
+  EhShell_t shell;
+
+  for (auto _ : state)
+  {
+    InitShell(shell, transport);
+    benchmark::DoNotOptimize(EhFeed(&shell, transport.Input.data(), transport.Input.size()));
+  }
+
+  state.SetBytesProcessed(state.iterations() * transport.Input.size());
+  state.counters["per_byte"] = TimePer(state.iterations() * transport.Input.size());
+}
+BENCHMARK(BM_FeedLineLength)->Arg(8)->Arg(32)->Arg(128)->Arg(EHSH_CMDLINE_SIZE);
+
+/// Tokenize, look up & call: EhRunScript() over lines of "cmdNNNN" plus arguments.
+static void BM_Dispatch(benchmark::State& state)
+{
+  constexpr size_t lines = 1000;
+  const Table      table(static_cast<size_t>(state.range(0)));
+  std::string      args;
+  for (int64_t i = 0; i < state.range(1); ++i)
+  {
+    args += " a";
+  }
+
+  Transport transport;
+  for (size_t i = 0; i < lines; ++i)
+  {
+    transport.Input += table.Pick(i) + args + "\n";
+  }
+  EhShell_t shell;
+
+  for (auto _ : state)
+  {
+    InitShell(shell, transport, table.Commands.data(), table.Commands.size());
+    benchmark::DoNotOptimize(EhRunScript(&shell, transport.Input.data(), transport.Input.size(), nullptr));
+  }
+
+  state.counters["per_dispatch"] = TimePer(state.iterations() * lines);
+}
+BENCHMARK(BM_Dispatch)->ArgsProduct({ { 5, 50, 500, 5000 }, { 0, 4, EHSH_MAX_ARGS } });
+
+/// Types all but the last character of a command name, tabs to complete it, then erases it.
+static void BM_CompleteUnique(benchmark::State& state)
+{
+  constexpr size_t completions = 1000;
+  const Table      table(static_cast<size_t>(state.range(0)));
+
+  Transport transport;
+  for (size_t i = 0; i < completions; ++i)
+  {
+    const std::string& name = table.Pick(i);
+    transport.Input += name.substr(0, name.size() - 1) + "\t" + std::string(name.size(), EHSH_ASCII_BS);
+  }
+  EhShell_t shell;
+
+  for (auto _ : state)
+  {
+    InitShell(shell, transport, table.Commands.data(), table.Commands.size());
+    benchmark::DoNotOptimize(EhFeed(&shell, transport.Input.data(), transport.Input.size()));
+  }
+
+  state.counters["per_completion"] = TimePer(state.iterations() * completions);
+}
+BENCHMARK(BM_CompleteUnique)->Arg(5)->Arg(50)->Arg(500)->Arg(5000);
+
+/// Tabs on a prefix shared by the whole table: fills the common prefix & lists or counts matches.
+static void BM_CompleteAmbiguous(benchmark::State& state)
+{
+  constexpr size_t completions = 1000;
+  const Table      table(static_cast<size_t>(state.range(0)));
+  const auto&      first  = table.Names.front();
+  const auto&      last   = table.Names.back();
+  size_t           common = 0;
+  while ((common < first.size()) && (first[common] == last[common]))
+  {
+    ++common;
+  }
+
+  Transport transport;
+  for (size_t i = 0; i < completions; ++i)
+  {
+    transport.Input += "c\t" + std::string(common, EHSH_ASCII_BS);
+  }
+  EhShell_t shell;
+
+  for (auto _ : state)
+  {
+    InitShell(shell, transport, table.Commands.data(), table.Commands.size());
+    benchmark::DoNotOptimize(EhFeed(&shell, transport.Input.data(), transport.Input.size()));
+  }
+
+  state.counters["per_completion"] = TimePer(state.iterations() * completions);
+}
+BENCHMARK(BM_CompleteAmbiguous)->Arg(5)->Arg(50)->Arg(500)->Arg(5000);
+
+/// Replays an input from the fuzzer's latency corpus through EhExec(), with its commands.
+static void BM_Corpus(benchmark::State& state, const std::string& input)
+{
+  const std::vector<EhCommand_t>& cmds = FuzzCommands();
+  Transport                       transport;
+  transport.Input = input;
+  EhShell_t shell;
+
+  for (auto _ : state)
+  {
+    InitShell(shell, transport, cmds.data(), cmds.size());
+    transport.Read = 0;
+    EhExec(&shell);
+  }
+
+  state.counters["per_byte"] = TimePer(state.iterations() * input.size());
+}
+
+/// Registers BM_Corpus/<name> for each file in test/corpus/latency.
+static const bool CORPUS_REGISTERED = [] {
+  std::vector<std::filesystem::path> paths;
+  for (const auto& entry : std::filesystem::directory_iterator(EHSH_CORPUS_DIR))
+  {
+    paths.push_back(entry.path());
+  }
+  std::sort(paths.begin(), paths.end());
+  for (const auto& path : paths)
+  {
+    std::ifstream     file(path, std::ios::binary);
+    const std::string input(std::istreambuf_iterator<char>(file), {});
+    benchmark::RegisterBenchmark(("BM_Corpus/" + path.filename().string()).c_str(), &BM_Corpus, input);
+  }
+  return true;
+}();
+
+/// Startup cost of EHSH_REGISTER_COMMAND(): sorting a table in link order (here
+/// shuffled), as the first EhInit() does. Includes copying the table back.
+static void BM_SortCommands(benchmark::State& state)
+{
+  const Table              table(static_cast<size_t>(state.range(0)));
+  std::vector<EhCommand_t> shuffled;
+  for (size_t i = 0; i < table.Names.size(); ++i)
+  {
+    shuffled.push_back({ table.Pick(i).c_str(), "", &Sink });
+  }
+  std::vector<EhCommand_t> cmds(shuffled.size());
+
+  for (auto _ : state)
+  {
+    cmds = shuffled;
+    EhSortCommands(cmds.data(), static_cast<uint16_t>(cmds.size()));
+    benchmark::DoNotOptimize(cmds.data());
+  }
+
+  state.counters["per_command"] = TimePer(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SortCommands)->Arg(10)->Arg(100)->Arg(1000);
+
+/// Formatted output through EhPrintf(), straight to the transport.
+static void BM_Printf(benchmark::State& state)
+{
+  Transport transport;
+  EhShell_t shell;
+  InitShell(shell, transport);
+
+  for (auto _ : state)
+  {
+    EhPrintf(&shell, "%-6s %4d %08x %.2d\r\n", "adc", 42, 0xBEEFU, -1234);
+  }
+
+  state.counters["per_call"] = TimePer(state.iterations());
+}
+BENCHMARK(BM_Printf);
+
+/// The same output formatted by snprintf() into a stack buffer, then EhPutStr(),
+/// as commands had to before EhPrintf().
+static void BM_Snprintf(benchmark::State& state)
+{
+  Transport transport;
+  EhShell_t shell;
+  InitShell(shell, transport);
+
+  for (auto _ : state)
+  {
+    char       buf[64];
+    const int  value = -1234;
+    const char sign  = (value < 0) ? '-' : ' ';
+    snprintf(buf, sizeof(buf), "%-6s %4d %08x %c%d.%02d\r\n", "adc", 42, 0xBEEFU, sign, std::abs(value) / 100, std::abs(value) % 100);
+    EhPutStr(&shell, buf);
+  }
+
+  state.counters["per_call"] = TimePer(state.iterations());
+}
+BENCHMARK(BM_Snprintf);
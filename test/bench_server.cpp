@@ -0,0 +1,150 @@
+/** @file
+ * SPDX-License-Identifier: BSL-1.0
+ *
+ * Commands/sec through the Unix domain socket server versus the number of
+ * connected sessions. Clients live in the same thread and are read via their
+ * own epoll instance, so only sockets with replies are touched.
+ */
+////////////////////////////////////////////////////////////////////////////////
+// $Headers
+////////////////////////////////////////////////////////////////////////////////
+// std
+#include <string>  // std::string
+#include <vector>  // std::vector
+
+// 3rd
+#include <benchmark/benchmark.h>
+
+// local
+#include <ehsh/ehsh.h>
+#include <ehsh/extra/ehcmd.h>
+#include <ehsh/platform/eh.server.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// $Globals
+////////////////////////////////////////////////////////////////////////////////
+const static EhCommand_t BUILTIN_COMMANDS[] = {
+  EHSH_COMMAND_COMMENT,
+  EHSH_COMMAND_ECHO,
+  EHSH_COMMAND_EXIT,
+  EHSH_COMMAND_HELP,
+  EHSH_COMMAND_STTY,
+};
+
+static const char COMMAND[] = "echo hi\n";
+static const char REPLY[]   = "hi\n";
+
+////////////////////////////////////////////////////////////////////////////////
+// $Functions
+////////////////////////////////////////////////////////////////////////////////
+/// A server with `sessions` connected clients.
+struct Fixture {
+  std::string              Path = "/tmp/ehsh.bench.sock";
+  EhServer_t               Server{};
+  std::vector<EhSession_t> Sessions;
+  std::vector<int>         Clients;
+  int                      EpollFd = epoll_create1(0);
+
+  explicit Fixture(size_t sessions)
+    : Sessions(sessions)
+  {
+    const EhConfig_t config = {
+      .Commands     = BUILTIN_COMMANDS,
+      .CommandCount = std::size(BUILTIN_COMMANDS),
+      .Eol          = EHSH_EOL_LF,
+      .Tty          = 0,
+      .Cr           = 0,
+      .Lf           = 1,
+    };
+    EhServerInit(&Server, Path.c_str(), Sessions.data(), (uint32_t)sessions, &config);
+
+    struct sockaddr_un addr = {};
+    addr.sun_family         = AF_UNIX;
+    strncpy(addr.sun_path, Path.c_str(), sizeof(addr.sun_path) - 1);
+    for (size_t i = 0; i < sessions; ++i)
+    {
+      const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+      connect(fd, (const struct sockaddr*)&addr, sizeof(addr));
+      struct epoll_event event;
+      event.events  = EPOLLIN;
+      event.data.fd = fd;
+      epoll_ctl(EpollFd, EPOLL_CTL_ADD, fd, &event);
+      Clients.push_back(fd);
+      while (Server.Active <= i)
+      {
+        EhServerPoll(&Server, 100);
+      }
+    }
+  }
+
+  ~Fixture()
+  {
+    for (const int fd : Clients)
+    {
+      close(fd);
+    }
+    close(EpollFd);
+    EhServerDeInit(&Server);
+    unlink(Path.c_str());
+  }
+
+  /// Reads whatever replies are ready; returns the number of bytes.
+  size_t Drain()
+  {
+    struct epoll_event events[64];
+    size_t             bytes = 0;
+    const int          count = epoll_wait(EpollFd, events, 64, 0);
+    for (int i = 0; i < count; ++i)
+    {
+      char          buf[256];
+      const ssize_t n = read(events[i].data.fd, buf, sizeof(buf));
+      bytes += (n > 0) ? (size_t)n : 0;
+    }
+    return bytes;
+  }
+
+  /// Sends COMMAND from each of the given clients, then serves until all have replied.
+  void Round(size_t first, size_t count)
+  {
+    for (size_t i = first; i < first + count; ++i)
+    {
+      (void)write(Clients[i], COMMAND, sizeof(COMMAND) - 1);
+    }
+    size_t expected = count * (sizeof(REPLY) - 1);
+    while (expected > 0)
+    {
+      EhServerPoll(&Server, 0);
+      expected -= Drain();
+    }
+  }
+};
+
+/// Every connected session sends one command per round.
+static void BM_ServerAllActive(benchmark::State& state)
+{
+  const size_t sessions = (size_t)state.range(0);
+  Fixture      fixture(sessions);
+
+  for (auto _ : state)
+  {
+    fixture.Round(0, sessions);
+  }
+
+  state.counters["commands/s"] = benchmark::Counter((double)(state.iterations() * sessions), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ServerAllActive)->RangeMultiplier(8)->Range(1, 4096)->Unit(benchmark::kMicrosecond);
+
+/// One session sends commands while the rest sit idle.
+static void BM_ServerOneActive(benchmark::State& state)
+{
+  const size_t sessions = (size_t)state.range(0);
+  Fixture      fixture(sessions);
+
+  for (auto _ : state)
+  {
+    fixture.Round(sessions - 1, 1);
+  }
+
+  state.counters["commands/s"] = benchmark::Counter((double)state.iterations(), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ServerOneActive)->RangeMultiplier(8)->Range(1, 4096)->Unit(benchmark::kMicrosecond);
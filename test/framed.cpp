@@ -0,0 +1,259 @@
+/** @file
+ * SPDX-License-Identifier: BSL-1.0
+ *
+ * Tests for framed mode. This is built with its own copy of ehsh with
+ * EHSH_CFG_FRAMED enabled & a 16 byte EHSH_FRAME_OUT_SIZE. The fixture plays
+ * the host, encoding requests & decoding responses.
+ */
+////////////////////////////////////////////////////////////////////////////////
+// $Headers
+////////////////////////////////////////////////////////////////////////////////
+// std
+#include <cstdint>  // uint8_t
+#include <string>   // std::string
+#include <vector>   // std::vector
+
+// 3rd
+#include <gtest/gtest.h>
+
+// local
+#include <ehsh/ehsh.h>
+#include <ehsh/extra/ehcmd.h>
+#include <ehsh/platform/eh.fptr.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// $Globals
+////////////////////////////////////////////////////////////////////////////////
+static int Spams = 0;  //< Number of times EhSpam ran
+
+/// Prints more than a response frame can hold.
+static void EhSpam(EhShell_t* shell)
+{
+  ++Spams;
+  EhPutStr(shell, "0123456789abcdefghij");
+}
+
+const static EhCommand_t BUILTIN_COMMANDS[] = {
+  EHSH_COMMAND_ECHO,
+  { "spam", "Prints a lot", &EhSpam },
+  EHSH_COMMAND_STTY,
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// $Functions
+////////////////////////////////////////////////////////////////////////////////
+/// Host side CRC-16/CCITT-FALSE, to check the shell's against.
+static uint16_t Crc16(const std::string& data)
+{
+  uint16_t crc = 0xFFFF;
+  for (const char chr : data)
+  {
+    crc ^= static_cast<uint16_t>(static_cast<uint8_t>(chr) << 8);
+    for (int bit = 0; bit < 8; ++bit)
+    {
+      crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+    }
+  }
+  return crc;
+}
+
+/// COBS-encodes data, with a trailing delimiter.
+static std::string Encode(const std::string& data)
+{
+  std::string out;
+  size_t      code = 0;
+  out.push_back('\0');
+  for (const char chr : data)
+  {
+    if (chr == '\0')
+    {
+      out[code] = static_cast<char>(out.size() - code);
+      code      = out.size();
+      out.push_back('\0');
+    }
+    else
+    {
+      out.push_back(chr);
+    }
+  }
+  out[code] = static_cast<char>(out.size() - code);
+  out.push_back('\0');
+  return out;
+}
+
+/// Splits output into delimited frames & COBS-decodes each.
+static std::vector<std::string> Decode(const std::string& wire)
+{
+  std::vector<std::string> frames;
+  std::string              frame;
+  size_t                   i = 0;
+  while (i < wire.size())
+  {
+    const uint8_t code = static_cast<uint8_t>(wire[i++]);
+    if (code == 0)
+    {
+      frames.push_back(frame);
+      frame.clear();
+    }
+    else
+    {
+      frame.append(wire, i, code - 1U);
+      i += code - 1U;
+      if ((code != 0xFF) && (i < wire.size()) && (wire[i] != '\0'))
+      {
+        frame.push_back('\0');
+      }
+    }
+  }
+  return frames;
+}
+
+/// Builds a request frame: sequence number, '\0'-separated words, then CRC.
+static std::string Request(uint8_t seq, const std::string& words)
+{
+  std::string payload(1, static_cast<char>(seq));
+  payload += words;
+  const uint16_t crc = Crc16(payload);
+  payload.push_back(static_cast<char>(crc >> 8));
+  payload.push_back(static_cast<char>(crc & 0xFF));
+  return Encode(payload);
+}
+
+/// Builds the response frame expected, before encoding.
+static std::string Response(uint8_t seq, EhFrameStatus_t status, const std::string& output)
+{
+  std::string payload(1, static_cast<char>(seq));
+  payload.push_back(static_cast<char>(status));
+  payload += output;
+  const uint16_t crc = Crc16(payload);
+  payload.push_back(static_cast<char>(crc >> 8));
+  payload.push_back(static_cast<char>(crc & 0xFF));
+  return payload;
+}
+
+class GivenFramedShell : public testing::Test {
+public:
+  GivenFramedShell() noexcept
+  {
+    Transport = {
+      .GetChar = &GetChar,
+      .PutChar = &PutChar,
+      .Context = this,
+    };
+    const EhConfig_t cfg = {
+      .Commands     = &BUILTIN_COMMANDS[0],
+      .CommandCount = std::size(BUILTIN_COMMANDS),
+      .Transport    = &Transport,
+      .Eol          = EHSH_EOL_LF,
+      .Tty          = true,
+      .Lf           = true,
+    };
+    EhInit(&Shell, &cfg);
+    Feed("stty +f\n");
+    Spams = 0;
+  }
+
+  static char GetChar(void* context)
+  {
+    (void)context;
+    return (char)-1;
+  }
+
+  static void PutChar(void* context, char chr)
+  {
+    static_cast<GivenFramedShell*>(context)->Output.push_back(chr);
+  }
+
+  void Feed(const std::string& input)
+  {
+    Output.clear();
+    EhFeed(&Shell, input.data(), input.size());
+  }
+
+protected:
+  EhShell_t     Shell{};
+  EhTransport_t Transport{};
+  std::string   Output{};
+};
+
+TEST_F(GivenFramedShell, WhenEnabled_ThenNoPromptFollows)
+{
+  Feed("");
+
+  ASSERT_TRUE(Shell.Framed);
+  ASSERT_EQ(Output, "");
+}
+
+TEST_F(GivenFramedShell, WhenArgumentHasSpaces_ThenItIsOneArgument)
+{
+  Feed(Request(7, std::string("echo\0a b", 8)));
+
+  const auto frames = Decode(Output);
+  ASSERT_EQ(1U, frames.size());
+  ASSERT_EQ(frames[0], Response(7, EHSH_FRAME_OK, "a b\n"));
+}
+
+TEST_F(GivenFramedShell, WhenRequestsArePipelined_ThenEachIsAnsweredInOrder)
+{
+  Feed(Request(0, std::string("echo\0x", 6)) + Request(1, "nope") + Request(2, std::string("echo\0\0y", 7)));
+
+  const auto frames = Decode(Output);
+  ASSERT_EQ(3U, frames.size());
+  ASSERT_EQ(frames[0], Response(0, EHSH_FRAME_OK, "x\n"));
+  ASSERT_EQ(frames[1], Response(1, EHSH_FRAME_NO_COMMAND, ""));
+  ASSERT_EQ(frames[2], Response(2, EHSH_FRAME_OK, "\ny\n"));
+}
+
+TEST_F(GivenFramedShell, WhenCrcIsWrong_ThenNothingRunsAndNextFrameIsHandled)
+{
+  std::string corrupt = Request(3, "spam");
+  corrupt[2] ^= 1;
+  Feed(std::string("\0\0", 2) + corrupt + Request(4, std::string("echo\0ok", 7)));
+
+  const auto frames = Decode(Output);
+  ASSERT_EQ(2U, frames.size());
+  ASSERT_EQ(frames[0], Response(3, EHSH_FRAME_BAD_FRAME, ""));
+  ASSERT_EQ(frames[1], Response(4, EHSH_FRAME_OK, "ok\n"));
+  ASSERT_EQ(0, Spams);
+}
+
+TEST_F(GivenFramedShell, WhenRequestOutgrowsCommandLine_ThenItIsABadFrame)
+{
+  Feed(Request(5, std::string("echo\0") + std::string(EHSH_CMDLINE_SIZE, 'z')));
+
+  const auto frames = Decode(Output);
+  ASSERT_EQ(1U, frames.size());
+  ASSERT_EQ(frames[0], Response(5, EHSH_FRAME_BAD_FRAME, ""));
+}
+
+TEST_F(GivenFramedShell, WhenOutputOverflows_ThenItIsTruncated)
+{
+  Feed(Request(6, "spam"));
+
+  const auto frames = Decode(Output);
+  ASSERT_EQ(1U, frames.size());
+  ASSERT_EQ(frames[0], Response(6, EHSH_FRAME_TRUNCATED, "0123456789abcdef"));
+  ASSERT_EQ(1, Spams);
+}
+
+TEST_F(GivenFramedShell, WhenTooManyArguments_ThenTheyAreRejected)
+{
+  Feed(Request(8, std::string("echo\0a\0b\0c\0d\0", 13)));
+
+  const auto frames = Decode(Output);
+  ASSERT_EQ(1U, frames.size());
+  ASSERT_EQ(frames[0], Response(8, EHSH_FRAME_BAD_ARGS, ""));
+}
+
+TEST_F(GivenFramedShell, WhenDisabledByRequest_ThenResponseIsFramedAndTextResumes)
+{
+  Feed(Request(9, std::string("stty\0-f", 7)));
+
+  const auto frames = Decode(Output);
+  ASSERT_EQ(1U, frames.size());
+  ASSERT_EQ(frames[0], Response(9, EHSH_FRAME_OK, ""));
+  ASSERT_FALSE(Shell.Framed);
+
+  Feed("echo hi\n");
+  ASSERT_EQ(Output, "echo hi\nhi\n> ");
+}
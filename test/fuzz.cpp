@@ -0,0 +1,400 @@
+/** @file
+ * SPDX-License-Identifier: BSL-1.0
+ *
+ * Fuzz target feeding arbitrary bytes through EhExec() & the fptr backend,
+ * timing each byte from one EhGetChar() to the next. Costs are instructions
+ * where Linux perf events allow, otherwise TSC cycles (or nanoseconds).
+ *
+ * Built with Clang, this is a libFuzzer target. With `EHSH_FUZZ_LATENCY=1` in
+ * the environment, each input's worst cost per byte also marks one of 256
+ * log-scale buckets as coverage, so libFuzzer keeps inputs that are slower
+ * than any before: e.g. `EHSH_FUZZ_LATENCY=1 fuzz -max_len=1024 corpus/`.
+ *
+ * Built with other compilers, a standalone driver replaces libFuzzer:
+ *
+ *   - `fuzz <file|dir>...` replays inputs, printing each one's worst cost per byte.
+ *   - `fuzz --search <dir> [iterations] [<file|dir>...]` hill-climbs from the
+ *     seeds below (& any given) towards the slowest byte, saving the slowest
+ *     inputs found to `<dir>`. Those in test/corpus/latency are replayed by
+ *     the `fuzz.corpus` test & by `bench` (BM_Corpus).
+ */
+////////////////////////////////////////////////////////////////////////////////
+// $Headers
+////////////////////////////////////////////////////////////////////////////////
+// std
+#include <algorithm>   // std::min, std::sort
+#include <bit>         // std::bit_width
+#include <chrono>      // std::chrono::steady_clock
+#include <cstdint>     // uint8_t, uint64_t
+#include <cstdio>      // fprintf, printf
+#include <cstdlib>     // abort, getenv
+#include <filesystem>  // std::filesystem
+#include <fstream>     // std::ifstream, std::ofstream
+#include <iterator>    // std::istreambuf_iterator
+#include <random>      // std::mt19937
+#include <string>      // std::string
+#include <vector>      // std::vector
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// local
+#include "fuzz.h"
+#include <ehsh/platform/eh.fptr.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// $Macros
+////////////////////////////////////////////////////////////////////////////////
+#ifndef EHSH_FUZZ_LIBFUZZER
+/// Set to 1 when linked with `-fsanitize=fuzzer`, which provides main()
+#define EHSH_FUZZ_LIBFUZZER 0
+#endif /* EHSH_FUZZ_LIBFUZZER */
+
+////////////////////////////////////////////////////////////////////////////////
+// $Types
+////////////////////////////////////////////////////////////////////////////////
+/// One pass of an input through a shell.
+struct Run {
+  const uint8_t*         Data;
+  size_t                 Size;
+  size_t                 Read;
+  uint64_t               Last;
+  size_t                 Ends;   ///< Times EOT was returned at the end of Data
+  std::vector<uint64_t>& Costs;  ///< Cost of handling each byte, 0 if never measured
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// $Globals
+////////////////////////////////////////////////////////////////////////////////
+#if EHSH_FUZZ_LIBFUZZER
+/// Worst cost per byte, by log-scale bucket; new buckets count as new coverage
+__attribute__((section("__libfuzzer_extra_counters"))) static uint8_t CostCounters[256];
+#endif /* EHSH_FUZZ_LIBFUZZER */
+
+////////////////////////////////////////////////////////////////////////////////
+// $Functions
+////////////////////////////////////////////////////////////////////////////////
+#ifdef __linux__
+/// Counter of user space instructions retired by this thread, or -1 if denied.
+static int InstructionCounter()
+{
+  static const int fd = [] {
+    perf_event_attr attr{};
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.size           = sizeof(attr);
+    attr.config         = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+  }();
+  return fd;
+}
+#endif
+
+/// Current cost count: instructions if available, else cycles or nanoseconds.
+static uint64_t Ticks()
+{
+  uint64_t ticks   = 0;
+  bool     counted = false;
+#ifdef __linux__
+  counted = (InstructionCounter() >= 0) && (read(InstructionCounter(), &ticks, sizeof(ticks)) == sizeof(ticks));
+#endif
+  if (!counted)
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    ticks = __rdtsc();
+#else
+    ticks = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+  }
+  return ticks;
+}
+
+/// Unit of Ticks(), for reports.
+static const char* TickUnit()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  const char* unit = "cycles";
+#else
+  const char* unit = "ns";
+#endif
+#ifdef __linux__
+  unit = (InstructionCounter() >= 0) ? "instructions" : unit;
+#endif
+  return unit;
+}
+
+static char GetChar(EhShell_t* shell)
+{
+  const uint64_t now = Ticks();
+  Run&           run = *static_cast<Run*>(shell->Context);
+  char           chr = static_cast<char>(EHSH_ASCII_EOT);
+
+  if (run.Read > 0)
+  {
+    run.Costs[run.Read - 1] = now - run.Last;
+  }
+  if (run.Read < run.Size)
+  {
+    chr = static_cast<char>(run.Data[run.Read++]);
+  }
+  else if (++run.Ends > 64)
+  {
+    // EOT is being ignored: save the input for replay, & let libFuzzer report it
+    std::ofstream("hang", std::ios::binary).write(reinterpret_cast<const char*>(run.Data), run.Size);
+    fprintf(stderr, "Input of %zu bytes hangs EhExec(); saved to ./hang\n", run.Size);
+    abort();
+  }
+  run.Last = Ticks();
+  return chr;
+}
+
+static void PutChar(EhShell_t* shell, char chr)
+{
+  (void)shell;
+  (void)chr;
+}
+
+static void PutStr(EhShell_t* shell, const char* str)
+{
+  (void)shell;
+  (void)str;
+}
+
+/** Runs an input through a fresh shell several times.
+ *
+ * @param[out] at Optional; receives the offset of the worst byte.
+ * @return The worst cost of any one byte, taking each byte's cheapest run so
+ * interrupts & preemption don't count.
+ */
+static uint64_t Measure(const uint8_t* data, size_t size, int runs, size_t* at = nullptr)
+{
+  const std::vector<EhCommand_t>& cmds = FuzzCommands();
+  std::vector<uint64_t>           best(size, UINT64_MAX);
+  std::vector<uint64_t>           costs(size);
+
+  EhGetCharFn = &GetChar;
+  EhPutCharFn = &PutChar;
+  EhPutStrFn  = &PutStr;
+  for (int i = 0; i < runs; ++i)
+  {
+    const EhConfig_t cfg = {
+      .Commands     = cmds.data(),
+      .CommandCount = static_cast<uint16_t>(cmds.size()),
+      .Eol          = EHSH_EOL_LF,
+      .Tty          = true,
+      .Cr           = true,
+      .Lf           = true,
+    };
+    EhShell_t shell;
+    Run       run = { data, size, 0, 0, 0, costs };
+    std::fill(costs.begin(), costs.end(), 0);
+    EhInit(&shell, &cfg);
+    shell.Context = &run;
+    EhExec(&shell);
+    for (size_t j = 0; j < size; ++j)
+    {
+      best[j] = std::min(best[j], costs[j]);
+    }
+  }
+
+  const auto worst = std::max_element(best.begin(), best.end());
+  if (at != nullptr)
+  {
+    *at = static_cast<size_t>(worst - best.begin());
+  }
+  return best.empty() ? 0 : *worst;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+  const uint64_t worst = Measure(data, size, 1);
+#if EHSH_FUZZ_LIBFUZZER
+  static const bool latency = getenv("EHSH_FUZZ_LATENCY") != nullptr;
+  if (latency)
+  {
+    // 8 buckets per power of two
+    const int      bits   = std::bit_width(worst);
+    const uint64_t bucket = (bits <= 3) ? worst : ((8U * (bits - 3U)) + ((worst >> (bits - 4)) & 7U));
+    CostCounters[std::min<uint64_t>(bucket, std::size(CostCounters) - 1U)] = 1;
+  }
+#else
+  (void)worst;
+#endif /* EHSH_FUZZ_LIBFUZZER */
+  return 0;
+}
+
+#if !EHSH_FUZZ_LIBFUZZER
+/// Byte sequences the shell treats specially, for mutations to insert.
+static const char* const TOKENS[] = {
+  "\t", "\x7F", "\b", "\x1B[A", "\x1B[B", "\x1B[C", "\x1B[D", "\x1B[H", "\x1B[F", "\x1B[3~", "\x01", "\x05",
+  "\x0B", "\x15", "\x17", "\r", "\n", " ", ";", "\"", "cmd", "gpio ", "help ", "echo ", "stty ",
+};
+
+/// Known slow starts: listing every command, & filling then erasing the line.
+static std::vector<std::string> Seeds()
+{
+  return {
+    "\t\t",
+    "cmd\t\t",
+    "gpio \t\t",
+    "help\n",
+    std::string(255, 'x') + std::string(255, '\x7F') + "\n",
+    std::string(200, 'x') + std::string(200, '\x1B') + "[D" + "\x17\x15\n",
+    "echo" + std::string(15, ' ') + "a\n\x1B[A\x1B[A\n",
+  };
+}
+
+/// Reads every file given, or every file in each directory given, in name order.
+static std::vector<std::filesystem::path> Inputs(char** args, int count)
+{
+  std::vector<std::filesystem::path> paths;
+  for (int i = 0; i < count; ++i)
+  {
+    const std::filesystem::path path = args[i];
+    if (std::filesystem::is_directory(path))
+    {
+      std::vector<std::filesystem::path> files;
+      for (const auto& entry : std::filesystem::directory_iterator(path))
+      {
+        if (entry.is_regular_file())
+        {
+          files.push_back(entry.path());
+        }
+      }
+      std::sort(files.begin(), files.end());
+      paths.insert(paths.end(), files.begin(), files.end());
+    }
+    else if (args[i][0] != '-')  // Ignore libFuzzer flags, e.g. -runs=0
+    {
+      paths.push_back(path);
+    }
+  }
+  return paths;
+}
+
+static std::string Load(const std::filesystem::path& path)
+{
+  std::ifstream file(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static uint64_t Measure(const std::string& input, int runs, size_t* at = nullptr)
+{
+  return Measure(reinterpret_cast<const uint8_t*>(input.data()), input.size(), runs, at);
+}
+
+/// Applies 1 to 4 random edits, favoring ones that make long runs of special bytes.
+static std::string Mutate(std::string input, std::mt19937& rng)
+{
+  const int edits = 1 + static_cast<int>(rng() % 4);
+  for (int i = 0; i < edits; ++i)
+  {
+    const size_t pos = rng() % (input.size() + 1);
+    switch (rng() % 4)
+    {
+    case 0:
+      input.insert(pos, TOKENS[rng() % std::size(TOKENS)]);
+      break;
+    case 1: {
+      // Repeat a slice, e.g. to fill the line or stack up escape sequences
+      const std::string slice = input.substr(pos, 1 + (rng() % 16));
+      for (size_t n = 1 + (rng() % 32); n > 0; --n)
+      {
+        input.insert(pos, slice);
+      }
+      break;
+    }
+    case 2:
+      input.erase(pos, 1 + (rng() % 16));
+      break;
+    default:
+      if (!input.empty())
+      {
+        input[pos % input.size()] = static_cast<char>(rng());
+      }
+      break;
+    }
+  }
+  input.resize(std::min<size_t>(input.size(), 1024));
+  return input;
+}
+
+struct Candidate {
+  std::string Input;
+  uint64_t    Cost;
+};
+
+/// Keeps the 8 slowest inputs seen, mutating them in turn, then saves them.
+static int Search(const std::filesystem::path& out, unsigned long iterations, char** args, int count)
+{
+  std::vector<Candidate> pool;
+  std::vector<std::string> seeds = Seeds();
+  std::mt19937           rng(1);
+  for (const auto& path : Inputs(args, count))
+  {
+    seeds.push_back(Load(path));
+  }
+  for (const std::string& seed : seeds)
+  {
+    pool.push_back({ seed, Measure(seed, 3) });
+  }
+
+  uint64_t worst = 0;
+  for (unsigned long i = 0; i < iterations; ++i)
+  {
+    std::sort(pool.begin(), pool.end(), [](const Candidate& a, const Candidate& b) { return a.Cost > b.Cost; });
+    pool.resize(std::min<size_t>(pool.size(), 8));
+    if (pool[0].Cost > worst)
+    {
+      worst = pool[0].Cost;
+      printf("%lu: %llu %s/byte (%zu bytes)\n", i, static_cast<unsigned long long>(worst), TickUnit(), pool[0].Input.size());
+    }
+
+    Candidate child = { Mutate(pool[rng() % pool.size()].Input, rng), 0 };
+    child.Cost      = Measure(child.Input, 3);
+    const bool seen = std::any_of(pool.begin(), pool.end(), [&](const Candidate& c) { return c.Input == child.Input; });
+    if ((!seen) && (child.Cost > pool.back().Cost))
+    {
+      pool.push_back(child);
+    }
+  }
+
+  std::filesystem::create_directories(out);
+  for (size_t i = 0; i < pool.size(); ++i)
+  {
+    std::ofstream(out / ("latency-" + std::to_string(i)), std::ios::binary) << pool[i].Input;
+  }
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  int status = 0;
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+  if ((argc >= 3) && (std::string(argv[1]) == "--search"))
+  {
+    const bool          counted    = (argc >= 4) && (argv[3][0] >= '0') && (argv[3][0] <= '9');
+    const unsigned long iterations = counted ? std::stoul(argv[3]) : 20000;
+    status                         = Search(argv[2], iterations, &argv[counted ? 4 : 3], argc - (counted ? 4 : 3));
+  }
+  else
+  {
+    for (const auto& path : Inputs(&argv[1], argc - 1))
+    {
+      const std::string input = Load(path);
+      size_t            at    = 0;
+      const uint64_t    worst = Measure(input, 5, &at);
+      printf("%s: %zu bytes, worst %llu %s/byte at byte %zu\n", path.string().c_str(), input.size(),
+             static_cast<unsigned long long>(worst), TickUnit(), at);
+    }
+  }
+  return status;
+}
+#endif /* !EHSH_FUZZ_LIBFUZZER */
@@ -0,0 +1,70 @@
+/** @file
+ * SPDX-License-Identifier: BSL-1.0
+ *
+ * Commands shared by the fuzz target & the benchmark replaying its corpus, so
+ * inputs saved by one cost the same in the other. Both build ehsh with a 255
+ * character command line, 15 arguments & 128 bytes of history.
+ */
+#ifndef EHSH_TEST_FUZZ_H
+#define EHSH_TEST_FUZZ_H
+////////////////////////////////////////////////////////////////////////////////
+// $Headers
+////////////////////////////////////////////////////////////////////////////////
+// std
+#include <cstdio>  // snprintf
+#include <string>  // std::string
+#include <vector>  // std::vector
+
+// local
+#include <ehsh/ehsh.h>
+#include <ehsh/extra/ehcmd.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// $Functions
+////////////////////////////////////////////////////////////////////////////////
+/// Command callback that only touches its arguments' count.
+static inline void FuzzSink(EhShell_t* shell)
+{
+  volatile EhIndex_t count = shell->ArgCount;
+  (void)count;
+}
+
+/** Built-in commands, a `gpio` group, & 64 commands named "cmd00" to "cmd63",
+ * so completing "cmd" or an empty line lists a lot. Sorted on first use.
+ */
+static inline const std::vector<EhCommand_t>& FuzzCommands()
+{
+  static const EhCommand_t GPIO[] = {
+    { "get", "Reads a pin", &FuzzSink },
+    { "set", "Drives a pin", &FuzzSink },
+  };
+  static std::vector<std::string> names;
+  static std::vector<EhCommand_t> cmds;
+
+  if (cmds.empty())
+  {
+    for (int i = 0; i < 64; ++i)
+    {
+      char name[8];
+      snprintf(name, sizeof(name), "cmd%02d", i);
+      names.emplace_back(name);
+    }
+    for (const std::string& name : names)
+    {
+      cmds.push_back({ name.c_str(), "Does nothing", &FuzzSink });
+    }
+    cmds.insert(cmds.end(), {
+      EHSH_COMMAND_COMMENT,
+      EHSH_COMMAND_ECHO,
+      EHSH_COMMAND_EXIT,
+      EHSH_COMMAND_HELP,
+      EHSH_COMMAND_STTY,
+    });
+    cmds.push_back({ "gpio", "Pins", nullptr, nullptr, GPIO, 2 });
+    EhSortCommands(cmds.data(), static_cast<uint16_t>(cmds.size()));
+  }
+
+  return cmds;
+}
+
+#endif /* EHSH_TEST_FUZZ_H */
@@ -0,0 +1,249 @@
+/** @file
+ * SPDX-License-Identifier: BSL-1.0
+ *
+ * Tests for the Linux platform backend. stdin & stdout are redirected to
+ * temporary files, and `read()` & `write()` are wrapped (`-Wl,--wrap=...`) to
+ * count syscalls.
+ */
+////////////////////////////////////////////////////////////////////////////////
+// $Headers
+////////////////////////////////////////////////////////////////////////////////
+// std
+#include <cstdio>    // tmpfile
+#include <iostream>  // std::cerr
+#include <string>    // std::string
+
+// 3rd
+#include <gtest/gtest.h>
+
+// local
+#include <ehsh/ehsh.h>
+#include <ehsh/extra/ehcmd.h>
+#include <ehsh/platform/eh.linux.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// $Globals
+////////////////////////////////////////////////////////////////////////////////
+const static EhCommand_t BUILTIN_COMMANDS[] = {
+  EHSH_COMMAND_COMMENT,
+  EHSH_COMMAND_ECHO,
+  EHSH_COMMAND_EXIT,
+  EHSH_COMMAND_HELP,
+  EHSH_COMMAND_STTY,
+};
+
+static size_t Reads  = 0;  //< Number of read() syscalls from stdin
+static size_t Writes = 0;  //< Number of write() syscalls to stdout
+
+extern "C" ssize_t __real_read(int fd, void* buf, size_t count);
+extern "C" ssize_t __wrap_read(int fd, void* buf, size_t count)
+{
+  if (fd == STDIN_FILENO)
+  {
+    ++Reads;
+  }
+  return __real_read(fd, buf, count);
+}
+
+extern "C" ssize_t __real_write(int fd, const void* buf, size_t count);
+extern "C" ssize_t __wrap_write(int fd, const void* buf, size_t count)
+{
+  if (fd == STDOUT_FILENO)
+  {
+    ++Writes;
+  }
+  return __real_write(fd, buf, count);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// $Functions
+////////////////////////////////////////////////////////////////////////////////
+class GivenLinuxShell : public testing::Test {
+public:
+  /// Redirects stdin to read input, and stdout to a temporary file.
+  void Redirect(const std::string& input)
+  {
+    FILE* in  = tmpfile();
+    FILE* out = tmpfile();
+    fwrite(input.data(), 1, input.size(), in);
+    fflush(in);
+    rewind(in);
+
+    fflush(stdout);
+    SavedStdin  = dup(STDIN_FILENO);
+    SavedStdout = dup(STDOUT_FILENO);
+    dup2(fileno(in), STDIN_FILENO);
+    dup2(fileno(out), STDOUT_FILENO);
+    fclose(in);
+    fclose(out);
+  }
+
+  /// Restores stdin & stdout, returning everything written to stdout.
+  std::string Restore()
+  {
+    std::string output(static_cast<size_t>(lseek(STDOUT_FILENO, 0, SEEK_END)), '\0');
+    pread(STDOUT_FILENO, output.data(), output.size(), 0);
+
+    dup2(SavedStdin, STDIN_FILENO);
+    dup2(SavedStdout, STDOUT_FILENO);
+    close(SavedStdin);
+    close(SavedStdout);
+    return output;
+  }
+
+  /// Runs input through a shell, returning everything written to stdout.
+  std::string Run(const std::string& input, bool buffered, bool tty = true)
+  {
+    Redirect(input);
+
+    EhPlatform_t* platform = nullptr;
+    EhPlatformInit(&platform);
+    const EhConfig_t cfg = {
+      .Commands     = &BUILTIN_COMMANDS[0],
+      .CommandCount = std::size(BUILTIN_COMMANDS),
+      .Platform     = buffered ? platform : nullptr,
+      .Eol          = EHSH_EOL_LF,
+      .Tty          = tty,
+      .Cr           = true,
+      .Lf           = true,
+    };
+    EhShell_t shell;
+    EhInit(&shell, &cfg);
+
+    Reads  = 0;
+    Writes = 0;
+    EhExec(&shell);
+    EhDeInit(&shell);
+    EhPlatformDeInit(&platform);
+
+    return Restore();
+  }
+
+protected:
+  int SavedStdin{};
+  int SavedStdout{};
+};
+
+TEST_F(GivenLinuxShell, WhenBuffered_ThenOutputMatchesUnbuffered)
+{
+  const std::string input = "echo a b c\n# hi\nhelp\nexit\n";
+
+  const std::string unbuffered = Run(input, false);
+  const std::string buffered   = Run(input, true);
+
+  ASSERT_EQ(unbuffered, buffered);
+  ASSERT_NE(std::string::npos, buffered.find("stty: Configure shell EOL, TTY\r\n"));
+}
+
+TEST_F(GivenLinuxShell, WhenBuffered_ThenOneWritePerCommand)
+{
+  constexpr size_t commands = 100;
+  std::string      input;
+  for (size_t i = 0; i < commands; ++i)
+  {
+    input += "echo a b c\n";
+  }
+  input += "exit\n";
+
+  // Without echo, each command's output is only flushed once it completes
+  Run(input, false, false);
+  const size_t unbuffered = Writes;
+  Run(input, true, false);
+  const size_t buffered = Writes;
+
+  RecordProperty("WritesUnbuffered", std::to_string(unbuffered));
+  RecordProperty("WritesBuffered", std::to_string(buffered));
+  ASSERT_LE(buffered, commands + 1);
+  ASSERT_GE(unbuffered, 6 * buffered);
+}
+
+TEST_F(GivenLinuxShell, WhenStringLongerThanBufferPut_ThenWrittenInFull)
+{
+  const std::string text(EHSH_LINUX_TX_SIZE * 3 + 7, 'x');
+  Redirect("");
+
+  EhPlatform_t* platform = nullptr;
+  EhPlatformInit(&platform);
+  EhShell_t shell{};
+  shell.Platform = platform;
+  EhPutChar(&shell, '<');
+  EhPutStr(&shell, text.c_str());
+  EhPutChar(&shell, '>');
+  EhFlush(&shell);
+  EhPlatformDeInit(&platform);
+
+  ASSERT_EQ("<" + text + ">", Restore());
+}
+
+TEST_F(GivenLinuxShell, WhenLargeInputPiped_ThenSyscallsPerByteAreSmall)
+{
+  std::string input;
+  while (input.size() < (1 << 18))
+  {
+    input += "echo a b c\n# comment\n";
+  }
+  input += "exit\n";
+
+  const std::string unbufferedOutput = Run(input, false);
+  const double      unbuffered       = static_cast<double>(Reads + Writes) / input.size();
+  const std::string bufferedOutput   = Run(input, true);
+  const double      buffered         = static_cast<double>(Reads + Writes) / input.size();
+
+  RecordProperty("SyscallsPerByteUnbuffered", std::to_string(unbuffered));
+  RecordProperty("SyscallsPerByteBuffered", std::to_string(buffered));
+  std::cerr << "syscalls/byte: " << unbuffered << " unbuffered, " << buffered << " buffered\n";
+
+  ASSERT_EQ(unbufferedOutput, bufferedOutput);
+  ASSERT_GE(Reads, input.size() / EHSH_LINUX_RX_SIZE);
+  ASSERT_LT(buffered, 0.01);
+  ASSERT_GT(unbuffered, 1.0);
+}
+
+TEST_F(GivenLinuxShell, WhenScriptFileRun_ThenLinesPerSecondReported)
+{
+  std::string script;
+  for (size_t i = 0; i < 100000; ++i)
+  {
+    script += (i % 10 == 0) ? "# comment\n" : "echo a b\n";
+  }
+  char  path[] = "/tmp/ehsh.script.XXXXXX";
+  FILE* file   = fdopen(mkstemp(path), "w");
+  fwrite(script.data(), 1, script.size(), file);
+  fclose(file);
+
+  Redirect("");
+  EhPlatform_t* platform = nullptr;
+  EhPlatformInit(&platform);
+  const EhConfig_t cfg = {
+    .Commands     = &BUILTIN_COMMANDS[0],
+    .CommandCount = std::size(BUILTIN_COMMANDS),
+    .Platform     = platform,
+    .Tty          = true,
+    .Lf           = true,
+  };
+  EhShell_t shell;
+  EhInit(&shell, &cfg);
+
+  EhLinuxScript_t result;
+  const int       status = EhLinuxRunFile(&shell, path, &result);
+  EhPlatformDeInit(&platform);
+  const std::string output = Restore();
+  unlink(path);
+
+  RecordProperty("LinesPerSec", std::to_string(result.LinesPerSec));
+  std::cerr << "script: " << result.LinesPerSec << " lines/s\n";
+  ASSERT_EQ(0, status);
+  ASSERT_EQ(0, result.FailedLine);
+  ASSERT_EQ(100000, result.Lines);
+  ASSERT_GT(result.LinesPerSec, 0);
+  ASSERT_EQ(90000 * 4, output.size());  // "a\nb\n" per echo; no echo or prompts
+}
+
+TEST_F(GivenLinuxShell, WhenScriptFileMissing_ThenErrorReturned)
+{
+  EhShell_t       shell{};
+  EhLinuxScript_t result;
+
+  ASSERT_EQ(-1, EhLinuxRunFile(&shell, "/nonexistent/ehsh.script", &result));
+  ASSERT_EQ(ENOENT, errno);
+}
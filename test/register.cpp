@@ -0,0 +1,130 @@
+/** @file
+ * SPDX-License-Identifier: BSL-1.0
+ *
+ * Tests for commands registered with EHSH_REGISTER_COMMAND(). This is its own
+ * executable, so the registered commands are exactly the ones below, which are
+ * deliberately out of order.
+ */
+////////////////////////////////////////////////////////////////////////////////
+// $Headers
+////////////////////////////////////////////////////////////////////////////////
+// std
+#include <string>  // std::string
+
+// 3rd
+#include <gtest/gtest.h>
+
+// local
+#include <ehsh/ehsh.h>
+#include <ehsh/extra/ehcmd.h>
+#include <ehsh/platform/eh.fptr.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// $Globals
+////////////////////////////////////////////////////////////////////////////////
+/// Prints its name, to tell which command ran.
+static void EhZulu(EhShell_t* shell)
+{
+  EhPutStr(shell, "zulu\n");
+}
+
+/// Prints its name, to tell which command ran.
+static void EhAlpha(EhShell_t* shell)
+{
+  EhPutStr(shell, "alpha\n");
+}
+
+EHSH_REGISTER_COMMAND("zulu", "Last", EhZulu);
+EHSH_REGISTER_COMMAND("help", EHSH_HELP_HELP, EhHelp);
+EHSH_REGISTER_COMMAND("alpha", "First", EhAlpha);
+EHSH_REGISTER_COMMAND("echo", EHSH_HELP_ECHO, EhEcho);
+
+////////////////////////////////////////////////////////////////////////////////
+// $Functions
+////////////////////////////////////////////////////////////////////////////////
+class GivenRegisteredShell : public testing::Test {
+public:
+  GivenRegisteredShell() noexcept
+  {
+    Transport = {
+      .GetChar = &GetChar,
+      .PutChar = &PutChar,
+      .Context = this,
+    };
+    const EhConfig_t cfg = {
+      .Commands  = nullptr,
+      .Transport = &Transport,
+      .Eol       = EHSH_EOL_LF,
+      .Lf        = true,
+    };
+    Init = EhInit(&Shell, &cfg);
+  }
+
+  static char GetChar(void* context)
+  {
+    (void)context;
+    return (char)-1;
+  }
+
+  static void PutChar(void* context, char chr)
+  {
+    static_cast<GivenRegisteredShell*>(context)->Output.push_back(chr);
+  }
+
+  void Feed(const std::string& input)
+  {
+    Output.clear();
+    EhFeed(&Shell, input.data(), input.size());
+  }
+
+protected:
+  EhShell_t*    Init = nullptr;
+  EhShell_t     Shell{};
+  EhTransport_t Transport{};
+  std::string   Output{};
+};
+
+TEST_F(GivenRegisteredShell, WhenInitialized_ThenEveryRegistrationIsSortedByName)
+{
+  ASSERT_EQ(&Shell, Init);
+  ASSERT_EQ(4U, Shell.CmdCount);
+  ASSERT_STREQ("alpha", Shell.Cmds[0].Name);
+  ASSERT_STREQ("echo", Shell.Cmds[1].Name);
+  ASSERT_STREQ("help", Shell.Cmds[2].Name);
+  ASSERT_STREQ("zulu", Shell.Cmds[3].Name);
+}
+
+TEST_F(GivenRegisteredShell, WhenCommandEntered_ThenRegisteredCallbackRuns)
+{
+  Feed("zulu\nalpha\necho ok\n");
+
+  ASSERT_EQ(Output, "zulu\nalpha\nok\n");
+}
+
+TEST_F(GivenRegisteredShell, WhenHelpEntered_ThenRegisteredCommandsPrintedInOrder)
+{
+  Feed("help\n");
+
+  ASSERT_EQ(
+    Output,
+    "alpha: First\n"
+    "echo: Prints arguments\n"
+    "help: " EHSH_HELP_HELP "\n"
+    "zulu: Last\n");
+}
+
+TEST(EhSortCommands, WhenUnsorted_ThenSortedByName)
+{
+  EhCommand_t cmds[] = {
+    { "d", nullptr, nullptr }, { "b", nullptr, nullptr }, { "e", nullptr, nullptr },
+    { "a", nullptr, nullptr }, { "c", nullptr, nullptr }, { "ab", nullptr, nullptr },
+  };
+
+  EhSortCommands(cmds, std::size(cmds));
+
+  const char* expected[] = { "a", "ab", "b", "c", "d", "e" };
+  for (size_t i = 0; i < std::size(cmds); ++i)
+  {
+    ASSERT_STREQ(expected[i], cmds[i].Name);
+  }
+}
@@ -0,0 +1,185 @@
+/** @file
+ * SPDX-License-Identifier: BSL-1.0
+ *
+ * Tests for the SPSC receive ring. The stress test pushes from one thread &
+ * drains into a shell on another, pinned to different cores where available.
+ */
+////////////////////////////////////////////////////////////////////////////////
+// $Headers
+////////////////////////////////////////////////////////////////////////////////
+// std
+#include <string>  // std::string
+#include <thread>  // std::thread
+
+// 3rd
+#include <gtest/gtest.h>
+
+// local
+#include <ehsh/ehsh.h>
+#include <ehsh/extra/ehcmd.h>
+#include <ehsh/extra/ehring.h>
+#include <ehsh/platform/eh.fptr.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// $Globals
+////////////////////////////////////////////////////////////////////////////////
+static constexpr size_t LINES = 200000;
+
+const static EhCommand_t BUILTIN_COMMANDS[] = {
+  EHSH_COMMAND_ECHO,
+  EHSH_COMMAND_EXIT,
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// $Functions
+////////////////////////////////////////////////////////////////////////////////
+/// Pins a thread to one core, if there's more than one to choose from.
+static void Pin(std::thread& thread, unsigned core)
+{
+#ifdef __linux__
+  if (std::thread::hardware_concurrency() > 1)
+  {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % std::thread::hardware_concurrency(), &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+  }
+#else
+  (void)thread;
+  (void)core;
+#endif
+}
+
+class GivenRing : public testing::Test {
+public:
+  GivenRing() noexcept
+  {
+    Transport = {
+      .GetChar = &GetChar,
+      .PutChar = &PutChar,
+      .PutStr  = &PutStr,
+      .Context = this,
+    };
+    const EhConfig_t config = {
+      .Commands     = BUILTIN_COMMANDS,
+      .CommandCount = std::size(BUILTIN_COMMANDS),
+      .Transport    = &Transport,
+      .Eol          = EHSH_EOL_LF,
+      .Lf           = 1,
+    };
+    EhInit(&Shell, &config);
+  }
+
+  static char GetChar(void* context)
+  {
+    return EhRxGetChar(&static_cast<GivenRing*>(context)->Ring);
+  }
+
+  static void PutChar(void* context, char chr)
+  {
+    static_cast<GivenRing*>(context)->Output.push_back(chr);
+  }
+
+  static void PutStr(void* context, const char* str)
+  {
+    static_cast<GivenRing*>(context)->Output.append(str);
+  }
+
+protected:
+  EhRxRing_t    Ring{};
+  EhShell_t     Shell{};
+  EhTransport_t Transport{};
+  std::string   Output{};
+};
+
+TEST_F(GivenRing, WhenFull_ThenPushesAreDroppedAndCounted)
+{
+  const std::string input(EHSH_RX_RING_SIZE + 3, 'x');
+
+  ASSERT_EQ(EHSH_RX_RING_SIZE - 1, EhRxPushBlock(&Ring, input.data(), EHSH_RX_RING_SIZE - 1));
+  ASSERT_TRUE(EhRxPush(&Ring, 'y'));
+  ASSERT_FALSE(EhRxPush(&Ring, 'z'));
+  ASSERT_EQ(0U, EhRxPushBlock(&Ring, input.data(), input.size()));
+  ASSERT_EQ(1U + input.size(), EhRxOverruns(&Ring));
+}
+
+TEST_F(GivenRing, WhenPolled_ThenBytesArriveInOrderAcrossTheWrap)
+{
+  for (size_t i = 0; i < EHSH_RX_RING_SIZE - 4; ++i)
+  {
+    EhRxPush(&Ring, 'x');
+    EhRxGetChar(&Ring);
+  }
+  const std::string line = "echo 0123456789\n";
+  EhRxPushBlock(&Ring, line.data(), line.size());
+
+  ASSERT_EQ(EHSH_STATUS_RAN, EhPoll(&Shell));
+  ASSERT_EQ(Output, "0123456789\n");
+  ASSERT_EQ((char)-1, EhRxGetChar(&Ring));
+}
+
+TEST_F(GivenRing, WhenDrainedAcrossTheWrap_ThenShellGetsEveryByte)
+{
+  for (size_t i = 0; i < EHSH_RX_RING_SIZE - 4; ++i)
+  {
+    EhRxPush(&Ring, 'x');
+    EhRxGetChar(&Ring);
+  }
+  const std::string line = "echo a b\necho c\n";
+  EhRxPushBlock(&Ring, line.data(), line.size());
+
+  ASSERT_EQ(line.size(), EhRxDrain(&Ring, &Shell));
+  ASSERT_EQ(Output, "a\nb\nc\n");
+  ASSERT_EQ(0U, EhRxDrain(&Ring, &Shell));
+}
+
+TEST_F(GivenRing, WhenProducerAndConsumerRunConcurrently_ThenNoByteIsLostOrTorn)
+{
+  std::string expected;
+  uint32_t    dropped = 0;
+  std::thread producer([&] {
+    for (size_t i = 0; i < LINES; ++i)
+    {
+      const std::string line = "echo " + std::to_string(i) + "\n";
+      size_t            sent = 0;
+      while (sent < line.size())
+      {
+        // Alternate single & block pushes; retry what overran
+        const size_t length = (i % 2 == 0) ? (line.size() - sent) : 1;
+        const size_t pushed = EhRxPushBlock(&Ring, &line[sent], length);
+        sent += pushed;
+        dropped += (uint32_t)(length - pushed);
+        if (pushed < length)
+        {
+          std::this_thread::yield();
+        }
+      }
+      expected += std::to_string(i) + "\n";
+    }
+    while (!EhRxPush(&Ring, EHSH_ASCII_EOT))
+    {
+      ++dropped;
+    }
+  });
+  std::thread consumer([&] {
+    while (!Shell.Stop)
+    {
+      if (EhRxDrain(&Ring, &Shell) == 0)
+      {
+        std::this_thread::yield();
+      }
+    }
+  });
+  Pin(producer, 0);
+  Pin(consumer, 1);
+  producer.join();
+  consumer.join();
+
+  ASSERT_EQ(expected.size(), Output.size());
+  ASSERT_TRUE(expected == Output);
+  ASSERT_EQ(dropped, EhRxOverruns(&Ring));
+}
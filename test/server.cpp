@@ -0,0 +1,308 @@
+/** @file
+ * SPDX-License-Identifier: BSL-1.0
+ *
+ * Tests for the Unix domain socket server backend. Clients are plain
+ * non-blocking sockets in the same thread; the server is polled until the
+ * expected output arrives.
+ */
+////////////////////////////////////////////////////////////////////////////////
+// $Headers
+////////////////////////////////////////////////////////////////////////////////
+// std
+#include <string>  // std::string
+#include <vector>  // std::vector
+
+// 3rd
+#include <gtest/gtest.h>
+
+// local
+#include <ehsh/ehsh.h>
+#include <ehsh/extra/ehcmd.h>
+#include <ehsh/platform/eh.server.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// $Globals
+////////////////////////////////////////////////////////////////////////////////
+/// Prints its step & yields until 3 steps are done.
+static void Sweep(EhShell_t* shell)
+{
+  if ((!shell->Interrupted) && (shell->State < 3))
+  {
+    EhPutDecimal(shell, shell->State++);
+    EhYield(shell);
+  }
+}
+
+const static EhCommand_t BUILTIN_COMMANDS[] = {
+  EHSH_COMMAND_COMMENT,
+  EHSH_COMMAND_ECHO,
+  EHSH_COMMAND_EXIT,
+  EHSH_COMMAND_HELP,
+  EHSH_COMMAND_STTY,
+  { "sweep", "Yields 3 times", &Sweep, nullptr },
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// $Functions
+////////////////////////////////////////////////////////////////////////////////
+class GivenServer : public testing::Test {
+public:
+  void SetUp() override
+  {
+    Path = testing::TempDir() + "ehsh.unit.sock";
+    const EhConfig_t config = {
+      .Commands     = BUILTIN_COMMANDS,
+      .CommandCount = sizeof(BUILTIN_COMMANDS) / sizeof(*BUILTIN_COMMANDS),
+      .Eol          = EHSH_EOL_LF,
+      .Tty          = 1,
+      .Cr           = 0,
+      .Lf           = 1,
+    };
+    Sessions.resize(2000);
+    ASSERT_EQ(0, EhServerInit(&Server, Path.c_str(), Sessions.data(), (uint32_t)Sessions.size(), &config));
+  }
+
+  void TearDown() override
+  {
+    for (const int fd : Clients)
+    {
+      close(fd);
+    }
+    EhServerDeInit(&Server);
+    unlink(Path.c_str());
+  }
+
+  /// Connects a new client & waits for the server to accept it.
+  int Connect()
+  {
+    struct sockaddr_un addr = {};
+    addr.sun_family         = AF_UNIX;
+    strncpy(addr.sun_path, Path.c_str(), sizeof(addr.sun_path) - 1);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    EXPECT_EQ(0, connect(fd, (const struct sockaddr*)&addr, sizeof(addr)));
+    Clients.push_back(fd);
+
+    const uint32_t active = Server.Active;
+    while (Server.Active == active)
+    {
+      EhServerPoll(&Server, 100);
+    }
+    return fd;
+  }
+
+  /// Polls the server until the client has received expected, or the peer closed.
+  std::string Receive(int fd, const std::string& expected)
+  {
+    std::string output;
+    bool        open = true;
+    while ((open) && (output.size() < expected.size()))
+    {
+      char          buf[256];
+      const ssize_t count = read(fd, buf, sizeof(buf));
+      if (count > 0)
+      {
+        output.append(buf, (size_t)count);
+      }
+      else if (count < 0)
+      {
+        EhServerPoll(&Server, 100);
+      }
+      open = (count != 0);
+    }
+    return output;
+  }
+
+  std::string Send(int fd, const std::string& input, const std::string& expected)
+  {
+    EXPECT_EQ((ssize_t)input.size(), write(fd, input.data(), input.size()));
+    return Receive(fd, expected);
+  }
+
+  std::string              Path;
+  EhServer_t               Server;
+  std::vector<EhSession_t> Sessions;
+  std::vector<int>         Clients;
+};
+
+TEST_F(GivenServer, WhenClientConnects_ThenPromptIsSent)
+{
+  const int fd = Connect();
+  EXPECT_EQ("> ", Receive(fd, "> "));
+}
+
+TEST_F(GivenServer, WhenSessionsInterleave_ThenEachHasItsOwnShell)
+{
+  const int a = Connect();
+  const int b = Connect();
+  Receive(a, "> ");
+  Receive(b, "> ");
+
+  EXPECT_EQ("ec", Send(a, "ec", "ec"));
+  EXPECT_EQ("echo b\nb\n> ", Send(b, "echo b\n", "echo b\nb\n> "));
+  EXPECT_EQ("ho a\na\n> ", Send(a, "ho a\n", "ho a\na\n> "));
+}
+
+TEST_F(GivenServer, WhenCommandYields_ThenItIsResumedWithoutFurtherInput)
+{
+  const int fd = Connect();
+  Receive(fd, "> ");
+
+  EXPECT_EQ("sweep\n012> ", Send(fd, "sweep\n", "sweep\n012> "));
+  EXPECT_EQ(EHSH_SERVER_END, Server.Busy);
+}
+
+TEST_F(GivenServer, WhenMoreIsTypedAheadThanFits_ThenTheRestIsHeldNotLost)
+{
+  const int fd = Connect();
+  Receive(fd, "> ");
+
+  std::string input = "sweep\n";
+  std::string want  = "sweep\n012> ";
+  for (char c = 'a'; c < 'g'; ++c)
+  {
+    input += std::string("echo ") + c + "\n";
+    want += std::string("echo ") + c + "\n" + c + "\n> ";
+  }
+  ASSERT_GT(input.size(), EHSH_TYPEAHEAD_SIZE + 6U);
+
+  EXPECT_EQ(want, Send(fd, input, want));
+}
+
+TEST_F(GivenServer, WhenShellHasATransport_ThenOutputGoesThereNotToTheSocket)
+{
+  const int fd = Connect();
+  Receive(fd, "> ");
+
+  std::string         captured;
+  const EhTransport_t capture = {
+    .PutChar = [](void* context, char chr) { static_cast<std::string*>(context)->push_back(chr); },
+    .Context = &captured,
+  };
+  Sessions[0].Shell.Transport = &capture;
+  EhPutStr(&Sessions[0].Shell, "framed");
+  EhFlush(&Sessions[0].Shell);
+  Sessions[0].Shell.Transport = nullptr;
+
+  EXPECT_EQ("framed", captured);
+  EXPECT_EQ(0U, Sessions[0].Platform.TxLength);
+}
+
+TEST_F(GivenServer, WhenExitIsSent_ThenSessionIsClosed)
+{
+  const int fd = Connect();
+  Receive(fd, "> ");
+
+  Send(fd, "exit\n", "exit\n");
+  while (Server.Active > 0)
+  {
+    EhServerPoll(&Server, 100);
+  }
+
+  char buf[16];
+  EXPECT_EQ(0, read(fd, buf, sizeof(buf)));
+}
+
+TEST_F(GivenServer, WhenClientHangsUp_ThenSessionIsReused)
+{
+  const int fd = Connect();
+  close(fd);
+  Clients.clear();
+  while (Server.Active > 0)
+  {
+    EhServerPoll(&Server, 100);
+  }
+
+  const int again = Connect();
+  EXPECT_EQ("> ", Receive(again, "> "));
+  EXPECT_EQ(1U, Server.Active);
+}
+
+TEST_F(GivenServer, WhenHungUpSessionsAreReused_ThenEveryFreeOneIsFound)
+{
+  for (size_t i = 0; i < Sessions.size(); ++i)
+  {
+    Receive(Connect(), "> ");
+  }
+  for (size_t i = 0; i < Clients.size(); i += 2)
+  {
+    close(Clients[i]);
+    Clients[i] = -1;
+  }
+  while (Server.Active > Sessions.size() / 2)
+  {
+    EhServerPoll(&Server, 100);
+  }
+
+  for (size_t i = 0; i < Sessions.size() / 2; ++i)
+  {
+    EXPECT_EQ("> ", Receive(Connect(), "> "));
+  }
+  EXPECT_EQ(Sessions.size(), Server.Active);
+}
+
+TEST(GivenServerConfig, WhenCommandsAreUnsorted_ThenInitFailsWithoutListening)
+{
+  const EhCommand_t commands[] = {
+    EHSH_COMMAND_HELP,
+    EHSH_COMMAND_ECHO,
+  };
+  const EhConfig_t config = {
+    .Commands     = commands,
+    .CommandCount = 2,
+  };
+  const std::string path = testing::TempDir() + "ehsh.unsorted.sock";
+  EhSession_t       session;
+  EhServer_t        server;
+
+  unlink(path.c_str());
+  errno = 0;
+  EXPECT_EQ(-1, EhServerInit(&server, path.c_str(), &session, 1, &config));
+  EXPECT_EQ(EINVAL, errno);
+  EXPECT_NE(0, access(path.c_str(), F_OK));
+}
+
+TEST_F(GivenServer, WhenThousandsOfSessionsAreIdle_ThenEachStillResponds)
+{
+  for (size_t i = 0; i < Sessions.size(); ++i)
+  {
+    Receive(Connect(), "> ");
+  }
+  ASSERT_EQ(Sessions.size(), Server.Active);
+
+  for (size_t i = 0; i < Clients.size(); i += 97)
+  {
+    const std::string line = "echo " + std::to_string(i) + "\n";
+    const std::string want = line + std::to_string(i) + "\n> ";
+    EXPECT_EQ(want, Send(Clients[i], line, want));
+  }
+}
+
+TEST_F(GivenServer, WhenClientStopsReading_ThenOutputIsDroppedNotBlocked)
+{
+  const int fd = Connect();
+  int       size = 4096;
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+  const std::string line = "echo 0123456789\n";
+  std::string       input;
+  for (size_t i = 0; i < 40000; ++i)
+  {
+    input += line;
+  }
+
+  size_t sent = 0;
+  while (sent < input.size())
+  {
+    const ssize_t count = write(fd, &input[sent], input.size() - sent);
+    if (count > 0)
+    {
+      sent += (size_t)count;
+    }
+    EhServerPoll(&Server, 0);
+  }
+  while (EhServerPoll(&Server, 0) > 0) {}
+
+  EXPECT_EQ(1U, Server.Active);
+  EXPECT_GT(Sessions[0].Platform.Dropped, 0U);
+}
@@ -0,0 +1,137 @@
+/** @file
+ * SPDX-License-Identifier: BSL-1.0
+ *
+ * Tests for per-command stats. This is built with its own copy of ehsh with
+ * EHSH_CFG_STATS enabled, timed by a fake clock that commands advance.
+ */
+////////////////////////////////////////////////////////////////////////////////
+// $Headers
+////////////////////////////////////////////////////////////////////////////////
+// std
+#include <cstdlib>  // strtoul
+#include <string>   // std::string
+
+// 3rd
+#include <gtest/gtest.h>
+
+// local
+#include <ehsh/ehsh.h>
+#include <ehsh/extra/ehcmd.h>
+#include <ehsh/platform/eh.fptr.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// $Globals
+////////////////////////////////////////////////////////////////////////////////
+static uint32_t Now = 0;  //< Fake clock, in ticks
+
+/// Advances the fake clock by its argument.
+static void EhWait(EhShell_t* shell)
+{
+  Now += static_cast<uint32_t>(strtoul(EhArgAt(shell, 0), nullptr, 10));
+}
+
+const static EhCommand_t BUILTIN_COMMANDS[] = {
+  EHSH_COMMAND_ECHO,
+  EHSH_COMMAND_HELP,
+  EHSH_COMMAND_STATS,
+  { "wait", "Advances the clock", &EhWait },
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// $Functions
+////////////////////////////////////////////////////////////////////////////////
+class GivenStatsShell : public testing::Test {
+public:
+  GivenStatsShell() noexcept
+  {
+    EhPutCharFn = &PutCharHook;
+    EhTicksFn   = &TicksHook;
+
+    const EhConfig_t cfg = {
+      .Commands     = &BUILTIN_COMMANDS[0],
+      .CommandCount = std::size(BUILTIN_COMMANDS),
+      .Stats        = Stats,
+      .Eol          = EHSH_EOL_LF,
+      .Lf           = true,
+    };
+    EhInit(&Shell, &cfg);
+    Shell.Context = this;
+  }
+
+  static void PutCharHook(EhShell_t* shell, char chr)
+  {
+    static_cast<GivenStatsShell*>(shell->Context)->Output.push_back(chr);
+  }
+
+  static uint32_t TicksHook(EhShell_t* shell)
+  {
+    (void)shell;
+    return Now;
+  }
+
+  void Feed(const std::string& input)
+  {
+    Output.clear();
+    EhFeed(&Shell, input.data(), input.size());
+  }
+
+protected:
+  EhShell_t   Shell{};
+  EhStats_t   Stats[std::size(BUILTIN_COMMANDS)]{};
+  std::string Output{};
+};
+
+TEST_F(GivenStatsShell, WhenCommandsRun_ThenCallsAndTicksAreRecorded)
+{
+  Feed("wait 20\nwait 60\nwait 40\necho\n");
+
+  const EhStats_t& wait = Stats[3];
+  ASSERT_EQ(3U, wait.Calls);
+  ASSERT_EQ(20U, wait.Min);
+  ASSERT_EQ(60U, wait.Max);
+  ASSERT_EQ(120U, wait.Total);
+  ASSERT_EQ(1U, wait.Histogram[5]);  // 16 to 31
+  ASSERT_EQ(2U, wait.Histogram[6]);  // 32 to 63
+  ASSERT_EQ(1U, Stats[0].Calls);
+  ASSERT_EQ(1U, Stats[0].Histogram[0]);
+  ASSERT_EQ(0U, Stats[1].Calls);
+}
+
+TEST_F(GivenStatsShell, WhenCallOverflowsHistogram_ThenLastBucketCountsIt)
+{
+  Feed("wait 4000000000\n");
+
+  ASSERT_EQ(1U, Stats[3].Histogram[EHSH_STATS_BUCKETS - 1]);
+}
+
+TEST_F(GivenStatsShell, WhenClockWrapsDuringCall_ThenDurationIsStillRight)
+{
+  Now = UINT32_MAX - 5;
+  Feed("wait 10\n");
+
+  ASSERT_EQ(10U, Stats[3].Max);
+}
+
+TEST_F(GivenStatsShell, WhenStatsEntered_ThenStatsArePrintedAndReset)
+{
+  Feed("wait 20\nwait 60\nwait 40\necho\n");
+  Feed("stats\n");
+
+  ASSERT_EQ(
+    Output,
+    "echo: 1 calls, 0 avg, 0 min, 0 max\n"
+    "  0+: 1\n"
+    "wait: 3 calls, 40 avg, 20 min, 60 max\n"
+    "  16+: 1, 32+: 2\n");
+
+  Feed("stats\n");
+  ASSERT_EQ(Output, "stats: 1 calls, 0 avg, 0 min, 0 max\n  0+: 1\n");
+}
+
+TEST_F(GivenStatsShell, WhenNoStatsGiven_ThenCommandsStillRun)
+{
+  Shell.Stats = nullptr;
+  Feed("echo a\nstats\n");
+
+  ASSERT_EQ(Output, "a\n");
+}
@@ -0,0 +1,119 @@
+/** @file
+ * SPDX-License-Identifier: BSL-1.0
+ *
+ * Stress test for per-shell transports: independent shells run concurrently
+ * on their own threads, each reading from & writing to its own buffers, with
+ * no global hooks set. Build with -fsanitize=thread to check for races.
+ */
+////////////////////////////////////////////////////////////////////////////////
+// $Headers
+////////////////////////////////////////////////////////////////////////////////
+// std
+#include <string>  // std::string
+#include <thread>  // std::thread
+#include <vector>  // std::vector
+
+// 3rd
+#include <gtest/gtest.h>
+
+// local
+#include <ehsh/ehsh.h>
+#include <ehsh/extra/ehcmd.h>
+#include <ehsh/platform/eh.fptr.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// $Globals
+////////////////////////////////////////////////////////////////////////////////
+static constexpr size_t THREADS = 8;
+static constexpr size_t LINES   = 20000;
+
+const static EhCommand_t BUILTIN_COMMANDS[] = {
+  EHSH_COMMAND_ECHO,
+  EHSH_COMMAND_EXIT,
+  EHSH_COMMAND_HELP,
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// $Functions
+////////////////////////////////////////////////////////////////////////////////
+/// One shell & the buffers behind its transport.
+struct Session {
+  std::string   Input;
+  size_t        Head = 0;
+  std::string   Output;
+  EhShell_t     Shell{};
+  EhTransport_t Transport{};
+
+  static char GetChar(void* context)
+  {
+    auto& self = *static_cast<Session*>(context);
+    return (self.Head < self.Input.size()) ? self.Input[self.Head++] : static_cast<char>(-1);
+  }
+
+  static void PutChar(void* context, char chr)
+  {
+    static_cast<Session*>(context)->Output.push_back(chr);
+  }
+
+  static void PutStr(void* context, const char* str)
+  {
+    static_cast<Session*>(context)->Output.append(str);
+  }
+
+  /// Feeds LINES commands through EhPoll() until exit, returning the expected output.
+  std::string Run(size_t id)
+  {
+    std::string expected = "> ";
+    for (size_t i = 0; i < LINES; ++i)
+    {
+      const std::string arg  = std::to_string(id) + "." + std::to_string(i);
+      const std::string line = "echo " + arg + "\n";
+      Input += line;
+      expected += line + arg + "\n> ";
+    }
+    Input += "exit\n";
+    expected += "exit\n> ";
+
+    Transport = {
+      .GetChar = &GetChar,
+      .PutChar = &PutChar,
+      .PutStr  = (id % 2 == 0) ? &PutStr : nullptr,
+      .Context = this,
+    };
+    const EhConfig_t config = {
+      .Commands     = BUILTIN_COMMANDS,
+      .CommandCount = std::size(BUILTIN_COMMANDS),
+      .Transport    = &Transport,
+      .Eol          = EHSH_EOL_LF,
+      .Tty          = 1,
+      .Lf           = 1,
+    };
+    EhInit(&Shell, &config);
+    while (EhPoll(&Shell) != EHSH_STATUS_STOPPED) {}
+    EhDeInit(&Shell);
+
+    return expected;
+  }
+};
+
+TEST(GivenShellsOnThreads, WhenEachHasItsOwnTransport_ThenNoOutputIsSharedOrLost)
+{
+  ASSERT_EQ(nullptr, EhPutCharFn);
+
+  std::vector<Session>     sessions(THREADS);
+  std::vector<std::string> expected(THREADS);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < THREADS; ++i)
+  {
+    threads.emplace_back([&, i] { expected[i] = sessions[i].Run(i); });
+  }
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+
+  for (size_t i = 0; i < THREADS; ++i)
+  {
+    EXPECT_EQ(expected[i], sessions[i].Output) << "Shell " << i;
+  }
+}
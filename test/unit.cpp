@@ -7,11 +7,14 @@
 // std
 #include <cstring>  // memset
 #include <string>   // std::string
+#include <vector>   // std::vector
 
 // 3rd
 #include <gtest/gtest.h>
 
 // local
+#include <UnitCommands.h>
+#include <UnitHelpCommands.h>
 #include <ehsh/ehsh.h>
 #include <ehsh/extra/ehcmd.h>
 #include <ehsh/platform/eh.fptr.h>
@@ -22,10 +25,10 @@
 static constexpr size_t  TEST_BUF_SIZE      = 128;
 const static EhCommand_t BUILTIN_COMMANDS[] = {
   EHSH_COMMAND_COMMENT,
-  EHSH_COMMAND_HELP,
   EHSH_COMMAND_ECHO,
-  EHSH_COMMAND_STTY,
   EHSH_COMMAND_EXIT,
+  EHSH_COMMAND_HELP,
+  EHSH_COMMAND_STTY,
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -54,9 +57,13 @@ public:
   static char GetCharHook(EhShell_t* shell)
   {
     auto& self = *static_cast<GivenShell*>(shell->Context);
-    char  chr  = self.Input.front();
+    char  chr  = static_cast<char>(-1);  // Nothing pending
 
-    self.Input.erase(0, 1);
+    if (!self.Input.empty())
+    {
+      chr = self.Input.front();
+      self.Input.erase(0, 1);
+    }
 
     return chr;
   }
@@ -130,6 +137,71 @@ TEST(GivenNoShell, WhenInitedWithNullShell_ThenNullReturned)
   ASSERT_EQ(nullptr, EhInit(nullptr, &config));
 }
 
+TEST(GivenNoShell, WhenInitedWithUnsortedCommands_ThenNullReturned)
+{
+  const EhCommand_t unsorted[] = {
+    EHSH_COMMAND_HELP,
+    EHSH_COMMAND_ECHO,
+  };
+  const EhConfig_t  config = {
+    .Commands     = unsorted,
+    .CommandCount = std::size(unsorted),
+  };
+  EhShell_t shell{};
+
+  ASSERT_EQ(nullptr, EhInit(&shell, &config));
+  ASSERT_EQ(0, shell.CmdCount);
+}
+
+TEST(GivenNoShell, WhenInitedWithDuplicateCommands_ThenNullReturned)
+{
+  const EhCommand_t duplicates[] = {
+    EHSH_COMMAND_ECHO,
+    EHSH_COMMAND_ECHO,
+  };
+  const EhConfig_t  config = {
+    .Commands     = duplicates,
+    .CommandCount = std::size(duplicates),
+  };
+  EhShell_t shell{};
+
+  ASSERT_EQ(nullptr, EhInit(&shell, &config));
+}
+
+TEST(GivenNoShell, WhenInitedWithMoreThan255Commands_ThenEveryCommandIsFound)
+{
+  std::vector<std::string> names;
+  for (int i = 0; i < 300; ++i)
+  {
+    names.push_back("cmd" + std::to_string(1000 + i));
+  }
+  std::vector<EhCommand_t> cmds;
+  for (const std::string& name : names)
+  {
+    cmds.push_back({ name.c_str(), "", nullptr });
+  }
+  const EhConfig_t config = {
+    .Commands     = cmds.data(),
+    .CommandCount = static_cast<uint16_t>(cmds.size()),
+  };
+  EhShell_t shell{};
+  ASSERT_EQ(&shell, EhInit(&shell, &config));
+
+  for (size_t i = 0; i < cmds.size(); ++i)
+  {
+    ASSERT_EQ(&cmds[i], EhFindCommand(&shell, names[i].c_str()));
+  }
+  ASSERT_EQ(nullptr, EhFindCommand(&shell, "cmd"));
+  ASSERT_EQ(nullptr, EhFindCommand(&shell, "cmd9999"));
+
+  uint16_t first = 0;
+  ASSERT_EQ(10, EhFindCommands(&shell, "cmd110", 6, &first));
+  ASSERT_EQ(100, first);
+  ASSERT_EQ(300, EhFindCommands(&shell, "", 0, &first));
+  ASSERT_EQ(0, first);
+  ASSERT_EQ(0, EhFindCommands(&shell, "x", 1, &first));
+}
+
 TEST_F(GivenTtyCrLfShell, WhenArgAtBeyondArgCount_ThenNullReturned)
 {
   ASSERT_EQ(nullptr, EhArgAt(&Shell, Shell.ArgCount));
@@ -192,11 +264,9 @@ TEST_F(GivenTtyCrLfShell, When1CommandMatchesInput_AndTabIsPressed_ThenTabComple
 
   EhExec(&Shell);
 
-  ASSERT_EQ(
-    Output,
-    "> ec\r\n"
-    "echo\r\n"
-    "> echo");
+  // Only the completed characters are sent
+  ASSERT_EQ(Output, "> echo");
+  ASSERT_STREQ(Shell.CmdLine, "echo");
 }
 
 TEST_F(GivenTtyCrLfShell, WhenMultipleCommandMatchesInput_AndTabIsPressed_ThenTabPrintsMatches)
@@ -214,6 +284,65 @@ TEST_F(GivenTtyCrLfShell, WhenMultipleCommandMatchesInput_AndTabIsPressed_ThenTa
     "> e");
 }
 
+TEST_F(GivenTtyCrLfShell, WhenMatchesShareAPrefix_AndTabIsPressed_ThenLongestCommonPrefixFilled)
+{
+  const EhCommand_t cmds[] = {
+    { "gpio_get", "", nullptr },
+    { "gpio_set", "", nullptr },
+    { "i2c", "", nullptr },
+  };
+  Shell.Cmds     = cmds;
+  Shell.CmdCount = std::size(cmds);
+
+  Input = "g\t\ts\t";
+  Input += static_cast<char>(EHSH_ASCII_EOT);
+
+  EhExec(&Shell);
+
+  ASSERT_EQ(
+    Output,
+    "> gpio_\r\n"
+    "gpio_get\r\n"
+    "gpio_set\r\n"
+    "> gpio_set");
+}
+
+TEST_F(GivenTtyCrLfShell, WhenBackspacedPastAMismatch_AndTabIsPressed_ThenMatchesAreWidened)
+{
+  Input = "ex" EHSH_BACKSPACE "c\t";
+  Input += static_cast<char>(EHSH_ASCII_EOT);
+
+  EhExec(&Shell);
+
+  ASSERT_STREQ(Shell.CmdLine, "echo");
+}
+
+TEST_F(GivenTtyCrLfShell, WhenMoreMatchesThanListMax_AndTabIsPressed_ThenCountPrinted)
+{
+  std::vector<std::string> names;
+  std::vector<EhCommand_t> cmds;
+  for (int i = 0; i <= EHSH_TAB_LIST_MAX; ++i)
+  {
+    names.push_back(std::string("c") + static_cast<char>('a' + i));
+  }
+  for (const std::string& name : names)
+  {
+    cmds.push_back({ name.c_str(), "", nullptr });
+  }
+  Shell.Cmds     = cmds.data();
+  Shell.CmdCount = cmds.size();
+
+  Input = "c\t";
+  Input += static_cast<char>(EHSH_ASCII_EOT);
+
+  EhExec(&Shell);
+
+  ASSERT_EQ(
+    Output,
+    "> c\r\n" + std::to_string(EHSH_TAB_LIST_MAX + 1) + " matches\r\n"
+    "> c");
+}
+
 TEST_F(GivenTtyCrLfShell, CommandHasNullName_AndTabIsPressed_ThenNothingPrinted)
 {
   const EhCommand_t nullcmd[] = {
@@ -420,10 +549,10 @@ TEST_F(GivenTtyCrLfShell, WhenHelpEntered_ThenCommandsPrinted)
     Screen,
     "> help\r\n"
     "#: Comment\r\n"
-    "help: Prints commands\r\n"
     "echo: Prints arguments\r\n"
-    "stty: Configure shell EOL, TTY\r\n"
     "exit: Quits the shell\r\n"
+    "help: Prints commands\r\n"
+    "stty: Configure shell EOL, TTY\r\n"
     "> ");
 }
 
@@ -534,3 +663,864 @@ TEST_F(GivenCrShell, WhenSttyEnteredWithMultipleCommands_ThenConfigUpdates)
   ASSERT_FALSE(Shell.Eol);
   ASSERT_TRUE(Shell.Tty);
 }
+
+TEST_F(GivenTtyCrLfShell, WhenPolledWithNoInput_ThenPromptPrintedOnceAndIdle)
+{
+  ASSERT_EQ(EHSH_STATUS_IDLE, EhPoll(&Shell));
+  ASSERT_EQ(EHSH_STATUS_IDLE, EhPoll(&Shell));
+
+  ASSERT_EQ(Output, "> ");
+}
+
+TEST_F(GivenTtyCrLfShell, WhenPolledWithPartialLine_ThenIdleUntilEolArrives)
+{
+  Input = "echo a";
+  ASSERT_EQ(EHSH_STATUS_IDLE, EhPoll(&Shell));
+
+  Input = "\r\n";
+  ASSERT_EQ(EHSH_STATUS_RAN, EhPoll(&Shell));
+
+  ASSERT_EQ(
+    Output,
+    "> echo a\r\n"
+    "a\r\n"
+    "> ");
+}
+
+TEST_F(GivenLfShell, WhenPolledWithTwoLines_ThenOneCommandRunsPerPoll)
+{
+  Input = "echo a\necho b\n";
+
+  ASSERT_EQ(EHSH_STATUS_RAN, EhPoll(&Shell));
+  ASSERT_EQ(Output, "a\n");
+  ASSERT_EQ(EHSH_STATUS_RAN, EhPoll(&Shell));
+  ASSERT_EQ(Output, "a\nb\n");
+  ASSERT_EQ(EHSH_STATUS_IDLE, EhPoll(&Shell));
+}
+
+TEST_F(GivenLfShell, WhenExitPolled_ThenStopped)
+{
+  Input = "exit\necho a\n";
+
+  ASSERT_EQ(EHSH_STATUS_STOPPED, EhPoll(&Shell));
+  ASSERT_EQ(Input, "echo a\n");
+}
+
+TEST_F(GivenTtyCrLfShell, WhenFedInBulk_ThenOutputMatchesPerCharInput)
+{
+  const std::string inputs[] = {
+    "echo a b c\r\n",
+    "ec\thelp e\r\n",
+    "exit" EHSH_BACKSPACE EHSH_DELETE "cho hello\r\n",
+    "echo abcdefghijklmnopqrstuvwxyz\r\nbogus\r\n",
+    "echo 1 2 3 4 5\r\n\xFFstty\r\n",
+  };
+
+  for (const std::string& input : inputs)
+  {
+    EhShell_t  perChar = Shell;
+    EhShell_t  bulk    = Shell;
+    const auto run     = [&](EhShell_t& shell, bool feed) {
+      Output.clear();
+      Input = input;
+      if (feed)
+      {
+        EXPECT_EQ(input.size(), EhFeed(&shell, input.data(), input.size()));
+      }
+      else
+      {
+        EhPoll(&shell);
+        while (!Input.empty())
+        {
+          EhPoll(&shell);
+        }
+      }
+      return Output;
+    };
+
+    const std::string expected = run(perChar, false);
+    Input.clear();
+    ASSERT_EQ(expected, run(bulk, true)) << input;
+    ASSERT_EQ(0, memcmp(perChar.CmdLine, bulk.CmdLine, sizeof(bulk.CmdLine))) << input;
+    ASSERT_EQ(perChar.Cursor, bulk.Cursor) << input;
+  }
+}
+
+TEST_F(GivenLfShell, WhenFedPastExit_ThenConsumptionStopsAtExit)
+{
+  const std::string input = "exit\necho a\n";
+
+  ASSERT_EQ(5, EhFeed(&Shell, input.data(), input.size()));
+  ASSERT_TRUE(Shell.Stop);
+  ASSERT_EQ(Output, "");
+}
+
+TEST(GivenNoShell, WhenInitedWithGeneratedTable_ThenEveryCommandIsFoundByHash)
+{
+  const EhConfig_t config = {
+    .Commands     = UnitCommands,
+    .CommandCount = UnitCommands_COUNT,
+    .Hash         = &UnitCommandsHash,
+  };
+  EhShell_t shell{};
+  ASSERT_EQ(&shell, EhInit(&shell, &config));
+
+  for (const EhCommand_t& cmd : UnitCommands)
+  {
+    ASSERT_EQ(&cmd, EhFindCommand(&shell, cmd.Name));
+  }
+  for (const char* bogus : { "", "e", "ech", "echoo", "Echo", "nul", "##", "bogus" })
+  {
+    ASSERT_EQ(nullptr, EhFindCommand(&shell, bogus)) << bogus;
+  }
+}
+
+TEST_F(GivenTtyCrLfShell, WhenCommandsAreHashed_ThenCommandsDispatch)
+{
+  Shell.Cmds     = UnitCommands;
+  Shell.CmdCount = UnitCommands_COUNT;
+  Shell.Hash     = &UnitCommandsHash;
+
+  Input = "echo a\r\nnull\r\nbogus\r\n";
+  Input += static_cast<char>(EHSH_ASCII_EOT);
+
+  EhExec(&Shell);
+
+  ASSERT_EQ(
+    Output,
+    "> echo a\r\n"
+    "a\r\n"
+    "> null\r\n"
+    "> bogus\r\n"
+    "No such command \"bogus\"\r\n"
+    "> ");
+}
+
+TEST_F(GivenLfShell, WhenHelpIsCompressed_ThenItIsExpandedAsPrinted)
+{
+  Shell.Cmds     = UnitHelpCommands;
+  Shell.CmdCount = UnitHelpCommands_COUNT;
+  Shell.HelpDict = &UnitHelpCommandsHelpDict;
+
+  Input = "help\n";
+  Input += static_cast<char>(EHSH_ASCII_EOT);
+
+  EhExec(&Shell);
+
+  ASSERT_GT(UnitHelpCommandsHelpDict.Count, 0U);
+  ASSERT_LT(strlen(UnitHelpCommands[0].Help), strlen("Prints the value of a [register]"));
+  ASSERT_EQ(
+    Output,
+    "get: Prints the value of a [register]\n"
+    "help: Prints the help of the commands\n"
+    "q?: Prints \"\\\" & ? as is\n"
+    "set: Sets the value of a [register]\n");
+}
+
+TEST_F(GivenLfShell, WhenHelpEndsInAnEmptyWord_ThenTheRestIsStillPrinted)
+{
+  static const char         Words[]   = "Sets ";
+  static const uint16_t     Offsets[] = { 0, 5, 5 };
+  static const EhHelpDict_t Dict      = { Words, Offsets, 2 };
+  Shell.HelpDict                      = &Dict;
+
+  // The second word is empty, & ends the string
+  EhPutHelp(&Shell, "\x80the value\x81");
+
+  ASSERT_EQ(Output, "Sets the value");
+}
+
+TEST_F(GivenTtyCrLfShell, WhenScriptRun_ThenCommandsRunWithoutEchoOrPrompt)
+{
+  const std::string script = "# provision\r\necho a b\r\n\r\necho c\n#echo d\necho e";
+  size_t            lines  = 0;
+
+  ASSERT_EQ(0, EhRunScript(&Shell, script.data(), script.size(), &lines));
+  ASSERT_EQ(6, lines);
+  ASSERT_EQ(Output, "a\r\nb\r\nc\r\ne\r\n");
+  ASSERT_TRUE(Shell.Tty);
+  ASSERT_EQ(0, Shell.Cursor);
+}
+
+TEST_F(GivenTtyCrLfShell, WhenScriptRunsStty_ThenTheModeChangePersists)
+{
+  const std::string script = "stty -t\n";
+
+  ASSERT_EQ(0, EhRunScript(&Shell, script.data(), script.size(), nullptr));
+  ASSERT_FALSE(Shell.Tty);
+}
+
+TEST_F(GivenLfShell, WhenScriptHasIndentedCommentsOrBlankLines_ThenTheyAreSkipped)
+{
+  const std::string script = "  # note\n\t\n \t \n\t#echo x\n  echo a\n";
+  size_t            lines  = 0;
+
+  ASSERT_EQ(0, EhRunScript(&Shell, script.data(), script.size(), &lines));
+  ASSERT_EQ(5, lines);
+  ASSERT_EQ(Output, "a\n");
+}
+
+TEST_F(GivenLfShell, WhenScriptLineFails_ThenItsLineNumberIsReturnedAndRunningStops)
+{
+  const std::string script = "echo a\n# bogus\nbogus x\necho b\n";
+
+  ASSERT_EQ(3, EhRunScript(&Shell, script.data(), script.size(), nullptr));
+  ASSERT_EQ(Output, "a\nNo such command \"bogus\"\n");
+}
+
+TEST_F(GivenLfShell, WhenScriptLineIsTooLong_ThenItFails)
+{
+  const std::string script = "echo a\necho " + std::string(EHSH_CMDLINE_SIZE, 'x') + "\n";
+
+  ASSERT_EQ(2, EhRunScript(&Shell, script.data(), script.size(), nullptr));
+  ASSERT_EQ(Output, "a\n");
+}
+
+TEST_F(GivenLfShell, WhenScriptExits_ThenRunningStops)
+{
+  const std::string script = "exit\necho a\n";
+  size_t            lines  = 0;
+
+  ASSERT_EQ(0, EhRunScript(&Shell, script.data(), script.size(), &lines));
+  ASSERT_EQ(1, lines);
+  ASSERT_TRUE(Shell.Stop);
+  ASSERT_EQ(Output, "");
+}
+
+TEST_F(GivenTtyCrLfShell, WhenUpArrowPressed_ThenPreviousCommandIsRedrawnOnce)
+{
+  Input = "echo a\r\nhelp ex\r\n";
+  EhPoll(&Shell);
+  EhPoll(&Shell);
+  Output.clear();
+
+  Input = "\x1B[A";
+  EhPoll(&Shell);
+
+  ASSERT_EQ(Output, "\r> help ex\x1B[K");
+  ASSERT_EQ(std::string(Shell.CmdLine), "help ex");
+  ASSERT_EQ(7, Shell.Cursor);
+}
+
+TEST_F(GivenTtyCrLfShell, WhenArrowsWalkHistory_ThenEntriesAreRecalledInOrder)
+{
+  const std::string commands = "echo 1\r\necho 22\r\necho 333\r\n";
+  EhFeed(&Shell, commands.data(), commands.size());
+
+  const std::string up   = "\x1B[A";
+  const std::string down = "\x1B[B";
+  const auto        line = [&](const std::string& keys) {
+    EhFeed(&Shell, keys.data(), keys.size());
+    return std::string(Shell.CmdLine);
+  };
+
+  ASSERT_EQ("echo 333", line(up));
+  ASSERT_EQ("echo 22", line(up));
+  ASSERT_EQ("echo 1", line(up));
+  ASSERT_EQ("echo 1", line(up));  // Oldest stays put
+  ASSERT_EQ("echo 22", line(down));
+  ASSERT_EQ("echo 333", line(down));
+  ASSERT_EQ("", line(down));
+  ASSERT_EQ("", line(down));
+}
+
+TEST_F(GivenTtyCrLfShell, WhenHistoryOverflows_ThenOldestEntriesAreEvicted)
+{
+  for (int i = 0; i < 100; ++i)
+  {
+    const std::string command = "echo " + std::to_string(i * 37) + "\r\n";
+    EhFeed(&Shell, command.data(), command.size());
+  }
+  ASSERT_LE(Shell.HistoryUsed, EHSH_HISTORY_SIZE);
+
+  const std::string up = "\x1B[A";
+  int               i  = 99;
+  for (; Shell.HistoryBack < Shell.HistoryUsed; --i)
+  {
+    EhFeed(&Shell, up.data(), up.size());
+    ASSERT_EQ("echo " + std::to_string(i * 37), std::string(Shell.CmdLine));
+  }
+  ASSERT_GT(i, 0);
+  ASSERT_LT(i, 90);
+}
+
+TEST_F(GivenTtyCrLfShell, WhenSameCommandRepeated_ThenStoredOnce)
+{
+  const std::string commands = "echo a\r\necho a\r\necho a\r\n";
+  EhFeed(&Shell, commands.data(), commands.size());
+
+  ASSERT_EQ(6 + (2 * sizeof(EhIndex_t)), Shell.HistoryUsed);
+}
+
+TEST_F(GivenTtyCrLfShell, WhenEscapeSequenceSplitAcrossPolls_ThenItIsStillDecoded)
+{
+  Input = "echo a\r\n";
+  EhPoll(&Shell);
+
+  for (const char chr : std::string("\x1B[A"))
+  {
+    Input = std::string(1, chr);
+    EhPoll(&Shell);
+    EhPoll(&Shell);  // Nothing pending
+  }
+
+  ASSERT_EQ(std::string(Shell.CmdLine), "echo a");
+}
+
+TEST_F(GivenTtyCrLfShell, WhenUnknownEscapeSequenceSent_ThenItIsIgnored)
+{
+  const std::string input = "ec\x1B[1;5Cho\r\n";
+  EhFeed(&Shell, input.data(), input.size());
+
+  ASSERT_EQ(Output, "> echo\r\n> ");
+}
+
+TEST_F(GivenTtyCrLfShell, WhenControlCutsEscapeSequenceShort_ThenItActsAsUsual)
+{
+  Input = "ec\x1B[1\t a\x1B[";
+  Input += static_cast<char>(EHSH_ASCII_EOT);
+
+  EhExec(&Shell);
+
+  ASSERT_TRUE(Shell.Stop);
+  ASSERT_EQ(std::string(Shell.CmdLine), "echo a");
+}
+
+TEST_F(GivenTtyCrLfShell, WhenCharTypedMidLine_ThenOnlyTheTailIsRedrawn)
+{
+  const std::string line = "eco a";
+  EhFeed(&Shell, line.data(), line.size());
+  Output.clear();
+
+  const std::string keys = "\x1B[D\x1B[D\x1B[Dh";
+  EhFeed(&Shell, keys.data(), keys.size());
+
+  ASSERT_EQ(Output, "\b\b\bho a\b\b\b");
+  ASSERT_EQ(std::string(Shell.CmdLine), "echo a");
+  ASSERT_EQ(3, Shell.Cursor);
+  ASSERT_EQ(6, Shell.Length);
+
+  Output.clear();
+  EhFeed(&Shell, "\r\n", 2);
+  ASSERT_EQ(Output, "\r\na\r\n> ");
+}
+
+TEST_F(GivenTtyCrLfShell, WhenBackspacedMidLine_ThenTailShiftsLeftAndIsBlanked)
+{
+  const std::string line = "echoo a\x1B[D\x1B[D";
+  EhFeed(&Shell, line.data(), line.size());
+  Output.clear();
+
+  EhFeed(&Shell, "\b", 1);
+
+  ASSERT_EQ(Output, "\b a \b\b\b");
+  ASSERT_EQ(std::string(Shell.CmdLine), "echo a");
+  ASSERT_EQ(4, Shell.Cursor);
+}
+
+TEST_F(GivenTtyCrLfShell, WhenBackspacedAtEndOfLine_ThenOutputIsUnchanged)
+{
+  EhFeed(&Shell, "ab", 2);
+  Output.clear();
+
+  EhFeed(&Shell, "\b", 1);
+
+  ASSERT_EQ(Output, "\b \b");
+}
+
+TEST_F(GivenTtyCrLfShell, WhenDeletePressed_ThenCharUnderCursorIsRemoved)
+{
+  const std::string line = "echoo a\x01\x1B[C\x1B[C\x1B[C\x1B[3~";
+  EhFeed(&Shell, line.data(), line.size());
+
+  ASSERT_EQ(std::string(Shell.CmdLine), "echo a");
+  ASSERT_EQ(3, Shell.Cursor);
+}
+
+TEST_F(GivenTtyCrLfShell, WhenHomeAndEndPressed_ThenCursorMovesInFewBytes)
+{
+  const std::string line = "echo abcdef";
+  EhFeed(&Shell, line.data(), line.size());
+  Output.clear();
+
+  EhFeed(&Shell, "\x1B[H", 3);
+  ASSERT_EQ(Output, "\x1B[11D");
+  ASSERT_EQ(0, Shell.Cursor);
+
+  Output.clear();
+  EhFeed(&Shell, "\x1B[F", 3);
+  ASSERT_EQ(Output, "\x1B[11C");
+  ASSERT_EQ(11, Shell.Cursor);
+
+  Output.clear();
+  EhFeed(&Shell, "\x02\x02\x06", 3);  // Ctrl-B, Ctrl-B, Ctrl-F
+  ASSERT_EQ(Output, "\b\be");
+  ASSERT_EQ(10, Shell.Cursor);
+}
+
+TEST_F(GivenTtyCrLfShell, WhenCtrlKPressed_ThenLineAfterCursorIsErased)
+{
+  const std::string line = "echo abcdef\x1B[1~\x1B[C\x1B[C\x1B[C\x1B[C\x0B";
+  EhFeed(&Shell, line.data(), line.size());
+
+  ASSERT_EQ(std::string(Shell.CmdLine), "echo");
+  ASSERT_EQ(4, Shell.Length);
+  ASSERT_EQ('\0', Shell.CmdLine[5]);
+}
+
+TEST_F(GivenTtyCrLfShell, WhenCtrlUPressed_ThenLineBeforeCursorIsErased)
+{
+  const std::string line = "junk echo a\x01\x06\x06\x06\x06\x06\x15";
+  EhFeed(&Shell, line.data(), line.size());
+  ASSERT_EQ(std::string(Shell.CmdLine), "echo a");
+  ASSERT_EQ(0, Shell.Cursor);
+
+  Output.clear();
+  EhFeed(&Shell, "\r\n", 2);
+  ASSERT_EQ(Output, "\r\na\r\n> ");
+}
+
+TEST_F(GivenTtyCrLfShell, WhenCtrlWPressed_ThenWordBeforeCursorIsErased)
+{
+  const std::string line = "echo a bb  \x17";
+  EhFeed(&Shell, line.data(), line.size());
+
+  ASSERT_EQ(std::string(Shell.CmdLine), "echo a ");
+  ASSERT_EQ(7, Shell.Length);
+}
+
+TEST_F(GivenTtyCrLfShell, WhenSegmentsSeparatedBySemicolons_ThenEachRunsWithOnePrompt)
+{
+  const std::string line = "echo a;echo b\n";
+  EhFeed(&Shell, line.data(), line.size());
+
+  ASSERT_EQ(Output, "> echo a;echo b\r\na\r\nb\r\n> ");
+}
+
+TEST_F(GivenLfShell, WhenSegmentFails_ThenItIsNamedAndTheRestIsSkipped)
+{
+  const std::string line = "echo a ; x;echo b\n";
+  EhFeed(&Shell, line.data(), line.size());
+
+  ASSERT_EQ(Output, "a\nNo such command \"x\"\nStopped at segment 2\n");
+}
+
+TEST_F(GivenLfShell, WhenSemicolonIsQuoted_ThenLineIsNotSplit)
+{
+  const std::string line = "echo \"a;b\";\n";
+  EhFeed(&Shell, line.data(), line.size());
+
+  ASSERT_EQ(Output, "\"a;b\"\n");
+}
+
+TEST_F(GivenLfShell, WhenScriptLineHasSegments_ThenAFailingSegmentFailsTheLine)
+{
+  const std::string script = "echo a;bogus\necho b\n";
+
+  ASSERT_EQ(1, EhRunScript(&Shell, script.data(), script.size(), nullptr));
+  ASSERT_EQ(Output, "a\nNo such command \"bogus\"\nStopped at segment 2\n");
+}
+
+TEST_F(GivenLfShell, WhenPrintfFormatsNumbers_ThenWidthPadAndSignAreApplied)
+{
+  EhPrintf(&Shell, "[%d|%5d|%-5d|%05d|%u|%x|%X|%lu]", -42, 42, 42, -42, 4294967295U, 0xbeefU, 0xbeefU, 123456789UL);
+
+  ASSERT_EQ(Output, "[-42|   42|42   |-0042|4294967295|beef|BEEF|123456789]");
+}
+
+TEST_F(GivenLfShell, WhenPrintfPrecisionGiven_ThenFixedPointIsPrinted)
+{
+  EhPrintf(&Shell, "%.2d %.2d %.1u %7.3d %.0d", 1234, -5, 7U, -1500, 3);
+
+  ASSERT_EQ(Output, "12.34 -0.05 0.7  -1.500 3");
+}
+
+TEST_F(GivenLfShell, WhenPrintfFormatsText_ThenItIsPadded)
+{
+  EhPrintf(&Shell, "%s:%4s|%-3c|%%|%s|%q", "a", "bc", 'x', static_cast<const char*>(nullptr));
+
+  ASSERT_EQ(Output, "a:  bc|x  |%|(null)|q");
+}
+
+/// Results of every EhArg parser on the first argument of the "p" command.
+struct Parsed {
+  bool     U32Ok;
+  uint32_t U32;
+  bool     I32Ok;
+  int32_t  I32;
+  bool     HexOk;
+  uint32_t Hex;
+  bool     BoolOk;
+  bool     Bool;
+  bool     FixedOk;
+  int32_t  Fixed;
+};
+
+class GivenSchemaShell : public GivenLfShell {
+public:
+  GivenSchemaShell() noexcept
+  {
+    const EhConfig_t cfg = {
+      .Commands     = &COMMANDS[0],
+      .CommandCount = std::size(COMMANDS),
+      .Eol          = EHSH_EOL_LF,
+      .Lf           = true,
+    };
+    EhInit(&Shell, &cfg);
+    Shell.Context = this;
+    Called        = false;
+  }
+
+  static void Parse(EhShell_t* shell)
+  {
+    Result         = {};
+    Result.U32Ok   = EhArgU32(shell, 0, &Result.U32);
+    Result.I32Ok   = EhArgI32(shell, 0, &Result.I32);
+    Result.HexOk   = EhArgHex(shell, 0, &Result.Hex);
+    Result.BoolOk  = EhArgBool(shell, 0, &Result.Bool);
+    Result.FixedOk = EhArgFixed(shell, 0, 2, &Result.Fixed);
+  }
+
+  static void Pwm(EhShell_t* shell)
+  {
+    Called = true;
+    std::copy(std::begin(shell->ArgValues), std::end(shell->ArgValues), std::begin(Values));
+  }
+
+  Parsed Feed(const std::string& line)
+  {
+    Output.clear();
+    EhFeed(&Shell, line.data(), line.size());
+    return Result;
+  }
+
+  static constexpr EhArgSpec_t PWM_ARGS[] = {
+    { .Name = "channel", .Type = EHSH_ARG_U32, .Min = 0, .Max = 3 },
+    { .Name = "duty", .Type = EHSH_ARG_FIXED, .Decimals = 1, .Min = 0, .Max = 1000 },
+    { .Name = "invert", .Type = EHSH_ARG_BOOL, .Optional = 1 },
+    EHSH_ARG_END,
+  };
+  static constexpr EhCommand_t COMMANDS[] = {
+    { "p", "Parses arg", &Parse, nullptr },
+    { "pwm", "Sets PWM", &Pwm, PWM_ARGS },
+  };
+
+  static inline Parsed       Result{};
+  static inline bool         Called = false;
+  static inline EhArgValue_t Values[EHSH_MAX_ARGS]{};
+};
+
+TEST_F(GivenSchemaShell, WhenNumbersParsed_ThenBoundsAndFormsAreChecked)
+{
+  ASSERT_TRUE(Feed("p 4294967295\n").U32Ok);
+  ASSERT_EQ(UINT32_MAX, Result.U32);
+  ASSERT_FALSE(Feed("p 4294967296\n").U32Ok);
+  ASSERT_EQ(0xBEEFU, Feed("p 0xbeef\n").U32);
+  ASSERT_FALSE(Feed("p 12a\n").U32Ok);
+  ASSERT_FALSE(Feed("p -1\n").U32Ok);
+
+  ASSERT_EQ(INT32_MIN, Feed("p -2147483648\n").I32);
+  ASSERT_FALSE(Feed("p 2147483648\n").I32Ok);
+  ASSERT_FALSE(Feed("p -\n").I32Ok);
+
+  ASSERT_EQ(0xFFFFFFFFU, Feed("p FFFFFFFF\n").Hex);
+  ASSERT_FALSE(Feed("p 0x100000000\n").HexOk);
+  ASSERT_FALSE(Feed("p 0x\n").HexOk);
+
+  ASSERT_EQ(-150, Feed("p -1.5\n").Fixed);
+  ASSERT_EQ(1234, Feed("p 12.34\n").Fixed);
+  ASSERT_FALSE(Feed("p 1.234\n").FixedOk);
+  ASSERT_FALSE(Feed("p 1.\n").FixedOk);
+  ASSERT_FALSE(Feed("p 21474837\n").FixedOk);
+}
+
+TEST_F(GivenSchemaShell, WhenBoolsParsed_ThenWordsAreAcceptedInAnyCase)
+{
+  ASSERT_TRUE(Feed("p ON\n").Bool);
+  ASSERT_TRUE(Feed("p yes\n").Bool);
+  ASSERT_FALSE(Feed("p False\n").Bool);
+  ASSERT_TRUE(Result.BoolOk);
+  ASSERT_FALSE(Feed("p of\n").BoolOk);
+  ASSERT_FALSE(Feed("p\n").BoolOk);
+}
+
+TEST_F(GivenSchemaShell, WhenArgsMatchSchema_ThenCallbackGetsParsedValues)
+{
+  Feed("pwm 3 99.5 on\n");
+
+  ASSERT_TRUE(Called);
+  ASSERT_EQ(3U, Values[0].U32);
+  ASSERT_EQ(995, Values[1].I32);
+  ASSERT_TRUE(Values[2].Bool);
+  ASSERT_EQ(Output, "");
+}
+
+TEST_F(GivenSchemaShell, WhenOptionalArgOmitted_ThenCallbackIsCalled)
+{
+  Feed("pwm 0 0\n");
+
+  ASSERT_TRUE(Called);
+}
+
+TEST_F(GivenSchemaShell, WhenArgIsOutOfBounds_ThenUsageIsPrintedInstead)
+{
+  Feed("pwm 4 50\n");
+
+  ASSERT_FALSE(Called);
+  ASSERT_EQ(Output, "Invalid channel; usage: pwm <channel> <duty> [invert]\n");
+}
+
+TEST_F(GivenSchemaShell, WhenArgIsMissingOrExtra_ThenUsageIsPrintedInstead)
+{
+  Feed("pwm 1\n");
+  ASSERT_EQ(Output, "Invalid duty; usage: pwm <channel> <duty> [invert]\n");
+
+  Feed("pwm 1 2 no x\n");
+  ASSERT_EQ(Output, "Too many arguments; usage: pwm <channel> <duty> [invert]\n");
+  ASSERT_FALSE(Called);
+}
+
+TEST_F(GivenSchemaShell, WhenScriptLineViolatesSchema_ThenItFails)
+{
+  const std::string script = "pwm 0 0\npwm 99 abc\npwm 1 1\n";
+
+  ASSERT_EQ(2, EhRunScript(&Shell, script.data(), script.size(), nullptr));
+  ASSERT_EQ(Output, "Invalid channel; usage: pwm <channel> <duty> [invert]\n");
+}
+
+class GivenYieldingShell : public GivenTtyCrLfShell {
+public:
+  GivenYieldingShell() noexcept
+  {
+    const EhConfig_t cfg = {
+      .Commands     = &COMMANDS[0],
+      .CommandCount = std::size(COMMANDS),
+      .Eol          = EHSH_EOL_LF,
+      .Tty          = true,
+      .Cr           = true,
+      .Lf           = true,
+    };
+    EhInit(&Shell, &cfg);
+    Shell.Context = this;
+    Shell.Prompt  = false;
+  }
+
+  /// Prints its step & yields until 3 steps are done; reports being interrupted.
+  static void Sweep(EhShell_t* shell)
+  {
+    if (shell->Interrupted)
+    {
+      EhPutStr(shell, "stopped");
+      EhPutNewline(shell);
+    }
+    else if (shell->State < 3)
+    {
+      EhPutDecimal(shell, shell->State++);
+      EhYield(shell);
+    }
+  }
+
+  static constexpr EhCommand_t COMMANDS[] = {
+    EHSH_COMMAND_ECHO,
+    EHSH_COMMAND_EXIT,
+    { "sweep", "Yields 3 times", &Sweep, nullptr },
+  };
+};
+
+TEST_F(GivenYieldingShell, WhenCommandYields_ThenEachPollResumesItUntilDone)
+{
+  Input = "sweep\n";
+
+  ASSERT_EQ(EHSH_STATUS_BUSY, EhPoll(&Shell));
+  ASSERT_EQ(EHSH_STATUS_BUSY, EhPoll(&Shell));
+  ASSERT_EQ(EHSH_STATUS_BUSY, EhPoll(&Shell));
+  ASSERT_EQ(EHSH_STATUS_RAN, EhPoll(&Shell));
+  ASSERT_EQ(EHSH_STATUS_IDLE, EhPoll(&Shell));
+  ASSERT_EQ(Output, "sweep\r\n012> ");
+}
+
+TEST_F(GivenYieldingShell, WhenTypingWhileRunning_ThenInputIsHandledAfterwards)
+{
+  Input = "sweep\n";
+  EhPoll(&Shell);
+
+  Input = "echo hi\n";
+  ASSERT_EQ(EHSH_STATUS_BUSY, EhPoll(&Shell));
+  ASSERT_EQ(Output, "sweep\r\n01");
+  ASSERT_EQ(EHSH_STATUS_BUSY, EhPoll(&Shell));
+  ASSERT_EQ(EHSH_STATUS_RAN, EhPoll(&Shell));
+  ASSERT_EQ(EHSH_STATUS_RAN, EhPoll(&Shell));
+
+  ASSERT_EQ(Output, "sweep\r\n012> echo hi\r\nhi\r\n> ");
+  ASSERT_EQ(0, Shell.TypeAheadLength);
+}
+
+TEST_F(GivenYieldingShell, WhenCtrlCPressedWhileRunning_ThenCommandIsCalledOnceMoreAndStops)
+{
+  Input = "sweep\n";
+  EhPoll(&Shell);
+
+  Input = "\x03";
+  ASSERT_EQ(EHSH_STATUS_RAN, EhPoll(&Shell));
+  ASSERT_EQ(Output, "sweep\r\n0stopped\r\n^C\r\n> ");
+  ASSERT_EQ(nullptr, Shell.Running);
+  ASSERT_FALSE(Shell.Interrupted);
+}
+
+TEST_F(GivenYieldingShell, WhenFedWhileRunning_ThenRestOfBufferWaitsForCommand)
+{
+  const std::string input = "sweep\necho a\n";
+  ASSERT_EQ(input.size(), EhFeed(&Shell, input.data(), input.size()));
+  ASSERT_EQ(Output, "sweep\r\n0");
+
+  EhFeed(&Shell, "", 0);
+  EhFeed(&Shell, "", 0);
+  EhFeed(&Shell, "", 0);
+  ASSERT_EQ(Output, "sweep\r\n012> echo a\r\na\r\n> ");
+}
+
+TEST_F(GivenYieldingShell, WhenTypeAheadIsFull_ThenFeedConsumesNoMore)
+{
+  EhFeed(&Shell, "sweep\n", 6);
+
+  const std::string input(EHSH_TYPEAHEAD_SIZE + 4, 'x');
+  ASSERT_EQ(EHSH_TYPEAHEAD_SIZE, EhFeed(&Shell, input.data(), input.size()));
+  ASSERT_NE(nullptr, Shell.Running);
+}
+
+TEST_F(GivenYieldingShell, WhenTypeAheadIsFull_ThenPollStillReadsCtrlC)
+{
+  Input = "sweep\n";
+  EhPoll(&Shell);
+
+  Input = std::string(EHSH_TYPEAHEAD_SIZE + 4, 'x') + "\x03";
+  ASSERT_EQ(EHSH_STATUS_RAN, EhPoll(&Shell));
+  ASSERT_EQ(Output, "sweep\r\n0stopped\r\n^C\r\n> ");
+  ASSERT_TRUE(Input.empty());
+  ASSERT_EQ(0, Shell.TypeAheadLength);
+}
+
+TEST_F(GivenYieldingShell, WhenTypeAheadIsFull_ThenFeedStillTakesCtrlC)
+{
+  EhFeed(&Shell, "sweep\n", 6);
+
+  const std::string input = std::string(EHSH_TYPEAHEAD_SIZE + 4, 'x') + "\x03" + "echo a\n";
+  ASSERT_EQ(input.size(), EhFeed(&Shell, input.data(), input.size()));
+  ASSERT_EQ(Output, "sweep\r\n0stopped\r\n^C\r\n> echo a\r\na\r\n> ");
+  ASSERT_EQ(nullptr, Shell.Running);
+}
+
+TEST_F(GivenYieldingShell, WhenSegmentYields_ThenTheNextSegmentRunsOnceItIsDone)
+{
+  EhFeed(&Shell, "sweep;echo a\n", 13);
+  EhFeed(&Shell, "", 0);
+  EhFeed(&Shell, "", 0);
+  ASSERT_EQ(Output, "sweep;echo a\r\n012");
+
+  EhFeed(&Shell, "", 0);
+  ASSERT_EQ(Output, "sweep;echo a\r\n012a\r\n> ");
+}
+
+TEST_F(GivenYieldingShell, WhenScriptRunsYieldingCommand_ThenItRunsToCompletion)
+{
+  const std::string script = "sweep\necho done\n";
+
+  ASSERT_EQ(0, EhRunScript(&Shell, script.data(), script.size(), nullptr));
+  ASSERT_EQ(Output, "012done\r\n");
+}
+
+class GivenGroupShell : public GivenTtyCrLfShell {
+public:
+  GivenGroupShell() noexcept
+  {
+    const EhConfig_t cfg = {
+      .Commands     = &COMMANDS[0],
+      .CommandCount = std::size(COMMANDS),
+      .Eol          = EHSH_EOL_LF,
+      .Tty          = true,
+      .Cr           = true,
+      .Lf           = true,
+    };
+    EhInit(&Shell, &cfg);
+    Shell.Context = this;
+    Shell.Prompt  = false;
+  }
+
+  void Feed(const std::string& input)
+  {
+    Output.clear();
+    EhFeed(&Shell, input.data(), input.size());
+  }
+
+  static constexpr EhCommand_t GPIO[] = {
+    { "get", "Reads a pin", &EhEcho },
+    { "set", "Drives a pin", &EhEcho },
+  };
+  static constexpr EhCommand_t COMMANDS[] = {
+    EHSH_COMMAND_ECHO,
+    { "gpio", "GPIO pins", nullptr, nullptr, GPIO, std::size(GPIO) },
+    EHSH_COMMAND_HELP,
+  };
+};
+
+TEST_F(GivenGroupShell, WhenSubcommandNamed_ThenItIsCalledWithTheRestOfTheArgs)
+{
+  Feed("gpio set 3 1\n");
+
+  ASSERT_EQ(Output, "gpio set 3 1\r\n3\r\n1\r\n> ");
+}
+
+TEST_F(GivenGroupShell, WhenSubcommandIsUnknown_ThenTheWholePathIsReported)
+{
+  Feed("gpio bad 3\n");
+
+  ASSERT_EQ(Output, "gpio bad 3\r\nNo such command \"gpio bad\"\r\n> ");
+}
+
+TEST_F(GivenGroupShell, WhenGroupNamedAlone_ThenItsSubcommandsAreListed)
+{
+  Feed("gpio\n");
+
+  ASSERT_EQ(Output, "gpio\r\nget: Reads a pin\r\nset: Drives a pin\r\n> ");
+}
+
+TEST_F(GivenGroupShell, WhenGroupNamedAloneInABatch_ThenTheRestStillRuns)
+{
+  Feed("gpio; gpio set 3\n");
+
+  ASSERT_EQ(Output, "gpio; gpio set 3\r\nget: Reads a pin\r\nset: Drives a pin\r\n3\r\n> ");
+}
+
+TEST_F(GivenGroupShell, WhenTabPressedWithinAGroup_ThenItsSubcommandsComplete)
+{
+  Feed("gp\t s\t");
+  ASSERT_EQ(Output, "gpio set");
+
+  Feed("\x17\t");
+  ASSERT_EQ(Output, "\b\b\b   \b\b\b\r\nget\r\nset\r\n> gpio ");
+}
+
+TEST_F(GivenGroupShell, WhenHelpNamesAGroup_ThenItLooksWithinIt)
+{
+  Feed("help gpio s\n");
+
+  ASSERT_EQ(Output, "help gpio s\r\nset: Drives a pin\r\n> ");
+}
+
+TEST(GivenNoShell, WhenInitedWithUnsortedSubcommands_ThenNullReturned)
+{
+  const EhCommand_t unsorted[] = {
+    { "set", "", nullptr },
+    { "get", "", nullptr },
+  };
+  const EhCommand_t commands[] = {
+    { "gpio", "", nullptr, nullptr, unsorted, std::size(unsorted) },
+  };
+  const EhConfig_t config = {
+    .Commands     = commands,
+    .CommandCount = std::size(commands),
+  };
+  EhShell_t shell{};
+
+  ASSERT_EQ(nullptr, EhInit(&shell, &config));
+}
@@ -0,0 +1,106 @@
+/** @file
+ * SPDX-License-Identifier: BSL-1.0
+ *
+ * Tests for large command lines. This is built with its own copy of ehsh
+ * configured for 32-bit indices, a 64 KiB command line, and 64 arguments.
+ */
+////////////////////////////////////////////////////////////////////////////////
+// $Headers
+////////////////////////////////////////////////////////////////////////////////
+// std
+#include <string>  // std::string
+
+// 3rd
+#include <gtest/gtest.h>
+
+// local
+#include <ehsh/ehsh.h>
+#include <ehsh/extra/ehcmd.h>
+#include <ehsh/platform/eh.fptr.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// $Globals
+////////////////////////////////////////////////////////////////////////////////
+const static EhCommand_t BUILTIN_COMMANDS[] = {
+  EHSH_COMMAND_COMMENT,
+  EHSH_COMMAND_ECHO,
+  EHSH_COMMAND_EXIT,
+  EHSH_COMMAND_HELP,
+  EHSH_COMMAND_STTY,
+};
+
+static EhShell_t Shell;  //< Too big for the stack
+
+////////////////////////////////////////////////////////////////////////////////
+// $Functions
+////////////////////////////////////////////////////////////////////////////////
+class GivenWideShell : public testing::Test {
+public:
+  GivenWideShell() noexcept
+  {
+    EhPutCharFn = &PutCharHook;
+
+    const EhConfig_t cfg = {
+      .Commands     = &BUILTIN_COMMANDS[0],
+      .CommandCount = std::size(BUILTIN_COMMANDS),
+      .Eol          = EHSH_EOL_LF,
+      .Lf           = true,
+    };
+    EhInit(&Shell, &cfg);
+    Shell.Context = this;
+  }
+
+  static void PutCharHook(EhShell_t* shell, char chr)
+  {
+    static_cast<GivenWideShell*>(shell->Context)->Output.push_back(chr);
+  }
+
+  void Feed(const std::string& input)
+  {
+    EhFeed(&Shell, input.data(), input.size());
+  }
+
+protected:
+  std::string Output{};
+};
+
+TEST(GivenWideConfig, WhenCompiled_ThenIndicesAreWide)
+{
+  ASSERT_EQ(4U, sizeof(EhIndex_t));
+  ASSERT_EQ(EHSH_MAX_ARGS, 64);
+  ASSERT_EQ(EHSH_CMDLINE_SIZE, 65536);
+}
+
+TEST_F(GivenWideShell, WhenLineIsLongerThan64KiB_ThenLineIsTruncatedToLastChar)
+{
+  Feed("echo " + std::string(EHSH_CMDLINE_SIZE, 'a') + "b\n");
+
+  ASSERT_EQ(std::string(EHSH_CMDLINE_SIZE - 6, 'a') + "b\n", Output);
+}
+
+TEST_F(GivenWideShell, WhenDozensOfArgsEntered_ThenEachIsTokenized)
+{
+  std::string input    = "echo";
+  std::string expected = "";
+  for (int i = 0; i < 50; ++i)
+  {
+    const std::string arg = std::to_string(i) + std::string(100, 'x');
+    input += " " + arg;
+    expected += arg + "\n";
+  }
+  Feed(input + "\n");
+
+  ASSERT_EQ(50U, Shell.ArgCount);
+  ASSERT_EQ(expected, Output);
+}
+
+TEST_F(GivenWideShell, WhenLongLineFollowsAnother_ThenNoStaleCharsRemain)
+{
+  Feed("echo " + std::string(1000, 'a') + " " + std::string(1000, 'b') + "\n");
+  Output.clear();
+
+  Feed("echo c\n");
+
+  ASSERT_EQ("c\n", Output);
+  ASSERT_EQ('\0', Shell.CmdLine[7]);
+}
@@ -0,0 +1,392 @@
+#[=======================================================================[.rst:
+ehsh_add_command_table
+----------------------
+
+Generates a sorted ``EhCommand_t`` table plus a minimal perfect hash over its
+names, and adds them to a target::
+
+  ehsh_add_command_table(<target>
+    NAME     <symbol>
+    [COMPRESS_HELP]
+    [HEADERS <header>...]
+    COMMANDS <name> <help> <callback> [<name> <help> <callback>...]
+  )
+
+Produces ``<symbol>.h`` (include it to get the declarations) and ``<symbol>.c``
+in the current binary dir, defining:
+
+- ``const EhCommand_t <symbol>[]``: commands sorted by name.
+- ``const EhPerfectHash_t <symbol>Hash``: pass as ``EhConfig_t.Hash``.
+- ``<symbol>_COUNT``: number of commands, for ``EhConfig_t.CommandCount``.
+
+``HEADERS`` are included by the generated source so it can see the callbacks.
+``<callback>`` may be ``NULL``. Help strings may not contain ``;``. Names may
+not contain whitespace, ``;`` or ``"``, which can't be typed as part of one,
+and the generated source fails to compile if the longest name exceeds
+``EHSH_CMDLINE_SIZE``.
+
+``COMPRESS_HELP`` stores every help string in one blob, replacing the words
+that pay for themselves (up to 128) with single bytes from 0x80 on, and also
+defines ``const EhHelpDict_t <symbol>HelpDict``: pass it as
+``EhConfig_t.HelpDict``, so ``help`` expands the words as it prints them.
+Help strings must then be printable ASCII.
+
+The hash is FNV-1a over the name, then per-bucket displacements are searched
+(hash-and-displace) so that every name lands in its own slot. This must stay
+in sync with ``EhHashName()`` & ``EhMix()`` in ``src/ehsh.c``.
+#]=======================================================================]
+include_guard(GLOBAL)
+
+# FNV-1a, 32-bit
+function(_ehsh_hash_name str out)
+  string(HEX "${str}" hex)
+  string(LENGTH "${hex}" hex_length)
+  set(hash 2166136261)
+  set(i 0)
+  while (i LESS hex_length)
+    string(SUBSTRING "${hex}" ${i} 2 byte)
+    math(EXPR hash "((${hash} ^ 0x${byte}) * 16777619) & 0xFFFFFFFF")
+    math(EXPR i "${i} + 2")
+  endwhile()
+  set(${out} ${hash} PARENT_SCOPE)
+endfunction()
+
+# hash ^ displacement, then a 32-bit integer finalizer, modulo slot count
+function(_ehsh_hash_slot hash displacement count out)
+  math(EXPR x "${hash} ^ ${displacement}")
+  math(EXPR x "((${x} >> 16) ^ ${x}) * 73244475 & 0xFFFFFFFF")
+  math(EXPR x "((${x} >> 16) ^ ${x}) % ${count}")
+  set(${out} ${x} PARENT_SCOPE)
+endfunction()
+
+function(_ehsh_c_string str out)
+  string(REPLACE "\\" "\\\\" str "${str}")
+  string(REPLACE "\"" "\\\"" str "${str}")
+  set(${out} "\"${str}\"" PARENT_SCOPE)
+endfunction()
+
+# Hex-encoded bytes as the body of a C string literal, escaping all but
+# printable ASCII (with fixed width octal, so digits can't run on)
+function(_ehsh_c_bytes hex out)
+  string(LENGTH "${hex}" hex_length)
+  set(bytes "")
+  set(i 0)
+  while (i LESS hex_length)
+    string(SUBSTRING "${hex}" ${i} 2 byte)
+    math(EXPR value "0x${byte}")
+    if ((value GREATER_EQUAL 32) AND (value LESS 127) AND (NOT value EQUAL 34) AND (NOT value EQUAL 63) AND (NOT value EQUAL 92))
+      string(ASCII ${value} chr)
+      string(APPEND bytes "${chr}")
+    else()
+      math(EXPR d1 "${value} >> 6")
+      math(EXPR d2 "(${value} >> 3) & 7")
+      math(EXPR d3 "${value} & 7")
+      string(APPEND bytes "\\${d1}${d2}${d3}")
+    endif()
+    math(EXPR i "${i} + 2")
+  endwhile()
+  set(${out} "${bytes}" PARENT_SCOPE)
+endfunction()
+
+# Splits each help string into words (with their trailing space), then makes
+# dictionary entries of the ones that save the most flash, & encodes the help
+# strings with them. Words are handled hex-encoded, as brackets would upset lists.
+# Sets _help_offset_<i> per sorted command, plus help_size, help_text,
+# dict_count, dict_words & dict_offsets, in the caller's scope.
+macro(_ehsh_compress_help)
+  string(ASCII 1 _ehsh_lb)
+  string(ASCII 2 _ehsh_rb)
+  set(_ehsh_pieces "")
+  set(i 0)
+  foreach (name IN LISTS names)
+    string(HEX "${name}" u)
+    math(EXPR h "${_index_${u}} * 3 + 1")
+    list(GET arg_COMMANDS ${h} help)
+    if (NOT help MATCHES "^[ -~]*$")
+      message(FATAL_ERROR "ehsh_add_command_table: COMPRESS_HELP needs printable ASCII help for \"${name}\"")
+    endif()
+    string(REPLACE "[" "${_ehsh_lb}" help "${help}")
+    string(REPLACE "]" "${_ehsh_rb}" help "${help}")
+    string(REGEX MATCHALL "[^ ]+ ?| " parts "${help}")
+    set(_ehsh_parts_${i} "")
+    foreach (part IN LISTS parts)
+      string(REPLACE "${_ehsh_lb}" "[" part "${part}")
+      string(REPLACE "${_ehsh_rb}" "]" part "${part}")
+      string(HEX "${part}" part)
+      if (NOT DEFINED _ehsh_count_${part})
+        set(_ehsh_count_${part} 0)
+        list(APPEND _ehsh_pieces ${part})
+      endif()
+      math(EXPR _ehsh_count_${part} "${_ehsh_count_${part}} + 1")
+      list(APPEND _ehsh_parts_${i} ${part})
+    endforeach()
+    math(EXPR i "${i} + 1")
+  endforeach()
+
+  # Each use saves length - 1 bytes; an entry costs its length plus an offset
+  set(_ehsh_ranked "")
+  foreach (part IN LISTS _ehsh_pieces)
+    string(LENGTH "${part}" part_length)
+    math(EXPR savings "${_ehsh_count_${part}} * (${part_length} / 2 - 1) - (${part_length} / 2 + 2)")
+    if (savings GREATER 0)
+      math(EXPR savings "1000000000 + ${savings}")
+      list(APPEND _ehsh_ranked "${savings}:${part}")
+    endif()
+  endforeach()
+  list(SORT _ehsh_ranked ORDER DESCENDING)
+  list(SUBLIST _ehsh_ranked 0 128 _ehsh_ranked)
+
+  set(dict_count 0)
+  set(dict_length 0)
+  set(dict_hex "")
+  set(dict_offsets "  0,\n")
+  foreach (entry IN LISTS _ehsh_ranked)
+    string(REGEX REPLACE "^[0-9]+:" "" part "${entry}")
+    math(EXPR code "0x80 + ${dict_count}" OUTPUT_FORMAT HEXADECIMAL)
+    string(SUBSTRING "${code}" 2 2 _ehsh_code_${part})
+    string(APPEND dict_hex "${part}")
+    string(LENGTH "${dict_hex}" dict_length)
+    math(EXPR dict_length "${dict_length} / 2")
+    string(APPEND dict_offsets "  ${dict_length},\n")
+    math(EXPR dict_count "${dict_count} + 1")
+  endforeach()
+  if (dict_length GREATER 65535)
+    message(FATAL_ERROR "ehsh_add_command_table: help dictionary for ${arg_NAME} exceeds 64 KiB")
+  endif()
+  _ehsh_c_bytes("${dict_hex}" dict_words)
+
+  set(help_size 0)
+  set(help_text "")
+  set(i 0)
+  foreach (name IN LISTS names)
+    set(_help_offset_${i} ${help_size})
+    set(encoded "")
+    foreach (part IN LISTS _ehsh_parts_${i})
+      if (DEFINED _ehsh_code_${part})
+        string(APPEND encoded "${_ehsh_code_${part}}")
+      else()
+        string(APPEND encoded "${part}")
+      endif()
+    endforeach()
+    string(APPEND encoded "00")
+    string(LENGTH "${encoded}" encoded_length)
+    math(EXPR help_size "${help_size} + ${encoded_length} / 2")
+    _ehsh_c_bytes("${encoded}" c_help)
+    string(APPEND help_text "  \"${c_help}\"\n")
+    math(EXPR i "${i} + 1")
+  endforeach()
+endmacro()
+
+function(ehsh_add_command_table target)
+  cmake_parse_arguments(PARSE_ARGV 1 arg "COMPRESS_HELP" "NAME" "HEADERS;COMMANDS")
+  if (NOT arg_NAME)
+    message(FATAL_ERROR "ehsh_add_command_table: NAME is required")
+  endif()
+  list(LENGTH arg_COMMANDS length)
+  math(EXPR count "${length} / 3")
+  math(EXPR remainder "${length} % 3")
+  if ((count EQUAL 0) OR (NOT remainder EQUAL 0) OR (count GREATER 65535))
+    message(FATAL_ERROR "ehsh_add_command_table: COMMANDS must be 1 to 65535 <name> <help> <callback> triples")
+  endif()
+
+  # Sort by name, keeping each name's index into COMMANDS in _index_<hex name>
+  set(names "")
+  set(max_length 0)
+  math(EXPR last "${count} - 1")
+  foreach (i RANGE ${last})
+    math(EXPR n "${i} * 3")
+    list(GET arg_COMMANDS ${n} name)
+    string(LENGTH "${name}" name_length)
+    if ((name_length EQUAL 0) OR (name_length GREATER 255))
+      message(FATAL_ERROR "ehsh_add_command_table: command \"${name}\" must be 1 to 255 characters")
+    endif()
+    if (name MATCHES "[ \t\r\n;\"]")
+      message(FATAL_ERROR "ehsh_add_command_table: command \"${name}\" contains whitespace, ';' or '\"', so can't be typed")
+    endif()
+    string(HEX "${name}" hex)
+    if (DEFINED _index_${hex})
+      message(FATAL_ERROR "ehsh_add_command_table: duplicate command name \"${name}\" in ${arg_NAME}")
+    endif()
+    set(_index_${hex} ${i})
+    if (name_length GREATER max_length)
+      set(max_length ${name_length})
+    endif()
+    list(APPEND names "${name}")
+  endforeach()
+  list(SORT names COMPARE STRING)
+
+  # Bucket names by hash
+  math(EXPR buckets "(${count} + 3) / 4")
+  set(i 0)
+  foreach (name IN LISTS names)
+    _ehsh_hash_name("${name}" hash)
+    string(LENGTH "${name}" _length_${i})
+    set(_hash_${i} ${hash})
+    math(EXPR bucket "${hash} % ${buckets}")
+    list(APPEND _bucket_${bucket} ${i})
+    math(EXPR i "${i} + 1")
+  endforeach()
+
+  # Place the largest buckets first, while the table is emptiest
+  set(max_size 0)
+  math(EXPR last_bucket "${buckets} - 1")
+  foreach (b RANGE ${last_bucket})
+    list(LENGTH _bucket_${b} size)
+    list(APPEND _size_${size} ${b})
+    if (size GREATER max_size)
+      set(max_size ${size})
+    endif()
+    set(_displacement_${b} 0)
+  endforeach()
+  foreach (size RANGE ${max_size} 1 -1)
+    foreach (b IN LISTS _size_${size})
+      set(d 0)
+      set(placed FALSE)
+      while (NOT placed)
+        if (d GREATER 65535)
+          message(FATAL_ERROR "ehsh_add_command_table: could not find a perfect hash for ${arg_NAME}")
+        endif()
+        set(placed TRUE)
+        set(taken "")
+        foreach (key IN LISTS _bucket_${b})
+          _ehsh_hash_slot(${_hash_${key}} ${d} ${count} slot)
+          if ((DEFINED _slot_${slot}) OR (slot IN_LIST taken))
+            set(placed FALSE)
+            break()
+          endif()
+          list(APPEND taken ${slot})
+        endforeach()
+        if (NOT placed)
+          math(EXPR d "${d} + 1")
+        endif()
+      endwhile()
+      set(_displacement_${b} ${d})
+      foreach (key slot IN ZIP_LISTS _bucket_${b} taken)
+        set(_slot_${slot} ${key})
+      endforeach()
+    endforeach()
+  endforeach()
+
+  # Emit source
+  set(includes "")
+  foreach (header IN LISTS arg_HEADERS)
+    string(APPEND includes "#include <${header}>\n")
+  endforeach()
+  if (arg_COMPRESS_HELP)
+    _ehsh_compress_help()
+  endif()
+  set(commands "")
+  set(sorted 0)
+  foreach (name IN LISTS names)
+    string(HEX "${name}" hex)
+    set(i ${_index_${hex}})
+    math(EXPR h "${i} * 3 + 1")
+    math(EXPR c "${i} * 3 + 2")
+    list(GET arg_COMMANDS ${h} help)
+    list(GET arg_COMMANDS ${c} callback)
+    _ehsh_c_string("${name}" c_name)
+    _ehsh_c_string("${help}" c_help)
+    if (arg_COMPRESS_HELP)
+      set(c_help "&${arg_NAME}HelpText[${_help_offset_${sorted}}]")
+    endif()
+    if (NOT callback STREQUAL "NULL")
+      set(callback "&${callback}")
+    endif()
+    string(APPEND commands "  { .Name = ${c_name}, .Help = ${c_help}, .Callback = ${callback} },\n")
+    math(EXPR sorted "${sorted} + 1")
+  endforeach()
+  set(help_declaration "")
+  set(help_definition "")
+  if (arg_COMPRESS_HELP)
+    set(help_declaration "/// Dictionary for the compressed help strings in ${arg_NAME}
+extern const EhHelpDict_t ${arg_NAME}HelpDict;
+")
+    set(help_definition "static const char ${arg_NAME}HelpText[${help_size}] =
+${help_text};
+
+static const char ${arg_NAME}HelpWords[] = \"${dict_words}\";
+
+static const uint16_t ${arg_NAME}HelpOffsets[${dict_count} + 1] = {
+${dict_offsets}};
+
+const EhHelpDict_t ${arg_NAME}HelpDict = {
+  ${arg_NAME}HelpWords,
+  ${arg_NAME}HelpOffsets,
+  ${dict_count},
+};
+")
+  endif()
+  set(displacements "")
+  foreach (b RANGE ${last_bucket})
+    string(APPEND displacements "  ${_displacement_${b}},\n")
+  endforeach()
+  set(slots "")
+  set(lengths "")
+  foreach (slot RANGE ${last})
+    set(key ${_slot_${slot}})
+    string(APPEND slots "  ${key},\n")
+    string(APPEND lengths "  ${_length_${key}},\n")
+  endforeach()
+
+  set(dir "${CMAKE_CURRENT_BINARY_DIR}/ehsh")
+  file(GENERATE
+    OUTPUT  "${dir}/${arg_NAME}.h"
+    CONTENT "/** @file
+ * Generated by ehsh_add_command_table() - do not edit.
+ */
+#ifndef ${arg_NAME}_H
+#define ${arg_NAME}_H
+#include <ehsh/ehsh.h>
+
+#ifdef __cplusplus
+extern \"C\" {
+#endif
+
+/// Number of commands in ${arg_NAME}
+#define ${arg_NAME}_COUNT ${count}
+
+/// Commands, sorted by name
+extern const EhCommand_t ${arg_NAME}[${count}];
+/// Minimal perfect hash over the names in ${arg_NAME}
+extern const EhPerfectHash_t ${arg_NAME}Hash;
+${help_declaration}
+#ifdef __cplusplus
+} // extern \"C\"
+#endif
+#endif /* ${arg_NAME}_H */
+"
+  )
+  file(GENERATE
+    OUTPUT  "${dir}/${arg_NAME}.c"
+    CONTENT "/** @file
+ * Generated by ehsh_add_command_table() - do not edit.
+ */
+#include \"${arg_NAME}.h\"
+${includes}
+#if ${max_length} > EHSH_CMDLINE_SIZE
+#error \"${arg_NAME} has a command name longer than EHSH_CMDLINE_SIZE, so it can't be typed\"
+#endif
+${help_definition}
+const EhCommand_t ${arg_NAME}[${count}] = {
+${commands}};
+
+static const uint16_t ${arg_NAME}Displacements[${buckets}] = {
+${displacements}};
+
+static const uint16_t ${arg_NAME}Slots[${count}] = {
+${slots}};
+
+static const uint8_t ${arg_NAME}Lengths[${count}] = {
+${lengths}};
+
+const EhPerfectHash_t ${arg_NAME}Hash = {
+  ${arg_NAME}Displacements,
+  ${arg_NAME}Slots,
+  ${arg_NAME}Lengths,
+  ${buckets},
+};
+"
+  )
+  target_sources(${target} PRIVATE "${dir}/${arg_NAME}.c")
+  target_include_directories(${target} PRIVATE "${dir}")
+endfunction()